@@ -0,0 +1,843 @@
+/*****************************************************************************
+
+ Copyright (c) 2010-2021  Monavacon Limited <http://www.monavacon.com/>
+ Copyright (c) 2002-2009  OpenSS7 Corporation <http://www.openss7.com/>
+ Copyright (c) 1997-2001  Brian F. G. Bidulock <bidulock@openss7.org>
+
+ All Rights Reserved.
+
+ This program is free software: you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation, version 3 of the license.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License along with
+ this program.  If not, see <http://www.gnu.org/licenses/>, or write to the
+ Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ -----------------------------------------------------------------------------
+
+ U.S. GOVERNMENT RESTRICTED RIGHTS.  If you are licensing this Software on
+ behalf of the U.S. Government ("Government"), the following provisions apply
+ to you.  If the Software is supplied by the Department of Defense ("DoD"), it
+ is classified as "Commercial Computer Software" under paragraph 252.227-7014
+ of the DoD Supplement to the Federal Acquisition Regulations ("DFARS") (or any
+ successor regulations) and the Government is acquiring only the license rights
+ granted herein (the license rights customarily provided to non-Government
+ users).  If the Software is supplied to any unit or agency of the Government
+ other than DoD, it is classified as "Restricted Computer Software" and the
+ Government's rights in the Software are defined in paragraph 52.227-19 of the
+ Federal Acquisition Regulations ("FAR") (or any successor regulations) or, in
+ the cases of NASA, in paragraph 18.52.227-86 of the NASA Supplement to the FAR
+ (or any successor regulations).
+
+ -----------------------------------------------------------------------------
+
+ Commercial licensing and support of this software is available from OpenSS7
+ Corporation at a fee.  See http://www.openss7.com/
+
+ *****************************************************************************/
+
+/*
+ * A stand-in for the AUR RPC API, for exercising and timing the AUR client of
+ * pacana reproducibly on a machine without network access.  It answers
+ * version 5 info and multiinfo requests, made with GET or POST, over local
+ * HTTP/1.1 from packages loaded from AUR metadata dumps and from responses
+ * recorded with pacana --record, and optionally makes up packages for names it
+ * does not have.  Latency and bandwidth limits can be injected to mimic a
+ * remote server.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "autoconf.h"
+#endif
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+
+/** @section Includes
+  * @{ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#ifdef _GNU_SOURCE
+#include <getopt.h>
+#endif
+#include <time.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <locale.h>
+#include <strings.h>
+
+#include <glib.h>
+
+#include <json-c/json.h>
+#include <zlib.h>
+
+/** @} */
+
+/** @section Debugging Preamble
+  * @{ */
+
+const char *
+_timestamp(void)
+{
+	static __thread struct timeval tv = { 0, 0 };
+	static __thread struct tm tm = { 0, };
+	static __thread char buf[BUFSIZ];
+	size_t len;
+
+	gettimeofday(&tv, NULL);
+	len = strftime(buf, sizeof(buf) - 1, "%b %d %T", gmtime_r(&tv.tv_sec, &tm));
+	snprintf(buf + len, sizeof(buf) - len - 1, ".%06ld", tv.tv_usec);
+	return buf;
+}
+
+#define DPRINTF(_num, _args...) do { if (options.debug >= _num) { \
+		fprintf(stderr, NAME "[%d]: D: [%s] %12s: +%4d : %s() : ", getpid(), _timestamp(), __FILE__, __LINE__, __func__); \
+		fprintf(stderr, _args); fflush(stderr); } } while (0)
+
+#define EPRINTF(_args...) do { \
+		fprintf(stderr, NAME "[%d]: E: [%s] %12s +%4d : %s() : ", getpid(), _timestamp(), __FILE__, __LINE__, __func__); \
+		fprintf(stderr, _args); fflush(stderr); } while (0)
+
+#define OPRINTF(_num, _args...) do { if (options.debug >= _num || options.output > _num) { \
+		fprintf(stdout, _args); fflush(stdout); } } while (0)
+
+/** @} */
+
+/** @section Definitions
+  * @{ */
+
+typedef enum {
+	CommandDefault,
+	CommandServe,
+	CommandHelp,
+	CommandVersion,
+} Command;
+
+#define AURD_DEFAULT_LISTEN	    "127.0.0.1:8080"
+#define AURD_MAXREQUEST		    (1 << 20)
+
+typedef struct {
+	int debug;
+	int output;
+	Command command;
+	char *listen;
+	GSList *data;			/* files and directories to load */
+	int synthetic;
+	long latency;
+	long bandwidth;
+} Options;
+
+Options options = {
+	.debug = 0,
+	.output = 1,
+	.command = CommandDefault,
+	.listen = NULL,
+	.data = NULL,
+	.synthetic = 0,
+	.latency = 0,
+	.bandwidth = 0,
+};
+
+/* name -> package, as compact JSON text, read-only once loaded so that it can
+   be shared by all connections */
+GHashTable *packages = NULL;
+
+/** @} */
+
+/** @section Package Store
+  * @{ */
+
+/** @brief add the package objects of an array to the store */
+static guint
+store_add(struct json_object *array)
+{
+	struct json_object *pkg, *obj;
+	const char *name;
+	guint i, n = 0;
+
+	for (i = 0; i < json_object_array_length(array); i++) {
+		pkg = json_object_array_get_idx(array, i);
+		if (!(obj = json_object_object_get(pkg, "Name")) || !(name = json_object_get_string(obj)))
+			continue;
+		g_hash_table_replace(packages, g_strdup(name),
+				     g_strdup(json_object_to_json_string_ext(pkg, JSON_C_TO_STRING_PLAIN)));
+		n++;
+	}
+	return (n);
+}
+
+/** @brief read a whole, possibly gzip compressed, file */
+static GString *
+store_read(const char *file)
+{
+	GString *data;
+	char buf[BUFSIZ];
+	gzFile gz;
+	int len;
+
+	if (!(gz = gzopen(file, "rb"))) {
+		EPRINTF("Could not open %s: %s\n", file, strerror(errno));
+		return (NULL);
+	}
+	data = g_string_new(NULL);
+	while ((len = gzread(gz, buf, sizeof(buf))) > 0)
+		g_string_append_len(data, buf, len);
+	if (len < 0) {
+		EPRINTF("Could not read %s\n", file);
+		g_string_free(data, TRUE);
+		data = NULL;
+	}
+	gzclose(gz);
+	return (data);
+}
+
+/** @brief load the packages of an AUR metadata dump (an array of packages) or
+  * of a recorded RPC response (an object with an array of results)
+  */
+static int
+store_load_file(const char *file)
+{
+	struct json_object *root, *array;
+	GString *data;
+	guint n = 0;
+
+	if (!(data = store_read(file)))
+		return (-1);
+	root = json_tokener_parse(data->str);
+	g_string_free(data, TRUE);
+	if (!root) {
+		EPRINTF("Could not parse %s\n", file);
+		return (-1);
+	}
+	if (json_object_is_type(root, json_type_array))
+		n = store_add(root);
+	else if ((array = json_object_object_get(root, "results")) && json_object_is_type(array, json_type_array))
+		n = store_add(array);
+	DPRINTF(1, "Loaded %u packages from %s\n", n, file);
+	json_object_put(root);
+	return (0);
+}
+
+/** @brief load all JSON files of a directory, such as one written by pacana
+  * --record
+  */
+static int
+store_load_dir(const char *path)
+{
+	GError *error = NULL;
+	const char *name;
+	char *file;
+	GDir *dir;
+	int err = 0;
+
+	if (!(dir = g_dir_open(path, 0, &error))) {
+		EPRINTF("Could not open %s: %s\n", path, error->message);
+		g_error_free(error);
+		return (-1);
+	}
+	while ((name = g_dir_read_name(dir))) {
+		if (!g_str_has_suffix(name, ".json") && !g_str_has_suffix(name, ".json.gz"))
+			continue;
+		file = g_build_filename(path, name, NULL);
+		if (store_load_file(file))
+			err = -1;
+		g_free(file);
+	}
+	g_dir_close(dir);
+	return (err);
+}
+
+static int
+store_load(void)
+{
+	GSList *d;
+	int err = 0;
+
+	packages = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	for (d = options.data; d; d = d->next) {
+		const char *path = d->data;
+
+		if (!strncmp(path, "file://", 7))
+			path += 7;
+		if (g_file_test(path, G_FILE_TEST_IS_DIR) ? store_load_dir(path) : store_load_file(path))
+			err = -1;
+	}
+	OPRINTF(1, "Serving %u packages\n", g_hash_table_size(packages));
+	return (err);
+}
+
+/** @brief make up a package for a name, the same one each time
+  *
+  * Of the names not in the store, options.synthetic percent exist, as decided
+  * by a hash of the name.  Some have no maintainer, some are flagged out of
+  * date and versions vary, so that all findings come up.
+  */
+static char *
+store_synthetic(const char *name)
+{
+	guint hash = g_str_hash(name);
+	struct json_object *pkg;
+	char *version, *text;
+
+	if (hash % 100 >= (guint) options.synthetic)
+		return (NULL);
+	hash /= 100;
+	pkg = json_object_new_object();
+	version = g_strdup_printf("%u.%u-%u", hash % 7, (hash >> 3) % 10, 1 + (hash >> 7) % 3);
+	json_object_object_add(pkg, "ID", json_object_new_int64(hash));
+	json_object_object_add(pkg, "Name", json_object_new_string(name));
+	json_object_object_add(pkg, "PackageBaseID", json_object_new_int64(hash));
+	json_object_object_add(pkg, "PackageBase", json_object_new_string(name));
+	json_object_object_add(pkg, "Version", json_object_new_string(version));
+	json_object_object_add(pkg, "Description", json_object_new_string("synthetic package"));
+	json_object_object_add(pkg, "Maintainer", (hash >> 9) % 10 ? json_object_new_string("nobody") : NULL);
+	json_object_object_add(pkg, "OutOfDate", (hash >> 13) % 10 ? NULL : json_object_new_int64(1600000000));
+	json_object_object_add(pkg, "NumVotes", json_object_new_int(0));
+	json_object_object_add(pkg, "Popularity", json_object_new_double(0));
+	json_object_object_add(pkg, "FirstSubmitted", json_object_new_int64(1500000000));
+	json_object_object_add(pkg, "LastModified", json_object_new_int64(1600000000));
+	text = g_strdup(json_object_to_json_string_ext(pkg, JSON_C_TO_STRING_PLAIN));
+	json_object_put(pkg);
+	g_free(version);
+	return (text);
+}
+
+/** @} */
+
+/** @section RPC Responses
+  * @{ */
+
+/** @brief decode a form or query component in place */
+static char *
+rpc_unescape(char *str)
+{
+	char *p, *q, hex[3] = { 0, };
+
+	for (p = q = str; *p; p++, q++) {
+		if (*p == '+')
+			*q = ' ';
+		else if (*p == '%' && g_ascii_isxdigit(p[1]) && g_ascii_isxdigit(p[2])) {
+			hex[0] = p[1];
+			hex[1] = p[2];
+			*q = strtol(hex, NULL, 16);
+			p += 2;
+		} else
+			*q = *p;
+	}
+	*q = '\0';
+	return (str);
+}
+
+static char *
+rpc_error(const char *message)
+{
+	struct json_object *resp = json_object_new_object();
+	char *text;
+
+	json_object_object_add(resp, "version", json_object_new_int(5));
+	json_object_object_add(resp, "type", json_object_new_string("error"));
+	json_object_object_add(resp, "resultcount", json_object_new_int(0));
+	json_object_object_add(resp, "results", json_object_new_array());
+	json_object_object_add(resp, "error", json_object_new_string(message));
+	text = g_strdup(json_object_to_json_string_ext(resp, JSON_C_TO_STRING_PLAIN));
+	json_object_put(resp);
+	return (text);
+}
+
+/** @brief answer the parameters of an RPC request, from a query string or a
+  * form encoded body
+  */
+static char *
+rpc_answer(char *params)
+{
+	char *param, *save = NULL, *value, *type = NULL, *text;
+	GString *out = g_string_new(NULL);
+	const char *found;
+	int version = 0;
+	guint count = 0;
+
+	for (param = strtok_r(params, "&", &save); param; param = strtok_r(NULL, "&", &save)) {
+		if (!(value = strchr(param, '=')))
+			continue;
+		*value++ = '\0';
+		rpc_unescape(param);
+		rpc_unescape(value);
+		if (!strcmp(param, "v"))
+			version = atoi(value);
+		else if (!strcmp(param, "type"))
+			type = value;
+		else if (!strcmp(param, "arg[]") || !strcmp(param, "arg")) {
+			char *made = NULL;
+
+			if (!(found = g_hash_table_lookup(packages, value)))
+				found = made = store_synthetic(value);
+			if (found) {
+				g_string_append(out, count++ ? "," : "");
+				g_string_append(out, found);
+			}
+			g_free(made);
+		}
+	}
+	if (version != 5) {
+		g_string_free(out, TRUE);
+		return (rpc_error("Invalid version specified."));
+	}
+	if (!type || (strcmp(type, "info") && strcmp(type, "multiinfo"))) {
+		g_string_free(out, TRUE);
+		return (rpc_error("Incorrect request type specified."));
+	}
+	text = g_strdup_printf("{\"version\":5,\"type\":\"multiinfo\",\"resultcount\":%u,\"results\":[%s]}",
+			       count, out->str);
+	g_string_free(out, TRUE);
+	return (text);
+}
+
+/** @} */
+
+/** @section HTTP Server
+  * @{ */
+
+/** @brief write all of a buffer, no faster than options.bandwidth */
+static int
+http_write(int fd, const char *data, size_t len)
+{
+	size_t chunk = options.bandwidth > 0 ? MAX(options.bandwidth / 10, 1) : len;
+	ssize_t n;
+
+	while (len) {
+		if ((n = write(fd, data, MIN(chunk, len))) < 0) {
+			if (errno == EINTR)
+				continue;
+			return (-1);
+		}
+		data += n;
+		len -= n;
+		if (options.bandwidth > 0 && len)
+			g_usleep(G_USEC_PER_SEC / 10);
+	}
+	return (0);
+}
+
+static int
+http_respond(int fd, int status, const char *reason, const char *body, gboolean keepalive)
+{
+	char *head;
+	int err;
+
+	head = g_strdup_printf("HTTP/1.1 %d %s\r\n"
+			       "Content-Type: application/json\r\n"
+			       "Content-Length: %zu\r\n"
+			       "Connection: %s\r\n"
+			       "\r\n", status, reason, strlen(body), keepalive ? "keep-alive" : "close");
+	if (options.latency > 0)
+		g_usleep(options.latency * 1000);
+	if (!(err = http_write(fd, head, strlen(head))))
+		err = http_write(fd, body, strlen(body));
+	g_free(head);
+	return (err);
+}
+
+/** @brief read from a connection until a buffer holds at least len bytes
+  * @return 0 when it does, -1 when the connection closed or failed first
+  */
+static int
+http_fill(int fd, GString *buf, size_t len)
+{
+	char data[BUFSIZ];
+	ssize_t n;
+
+	while (buf->len < len) {
+		if ((n = read(fd, data, sizeof(data))) < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return (-1);
+		g_string_append_len(buf, data, n);
+	}
+	return (0);
+}
+
+/** @brief serve the requests of one connection */
+static gpointer
+http_serve(gpointer data)
+{
+	int fd = GPOINTER_TO_INT(data);
+	GString *buf = g_string_new(NULL);
+
+	for (;;) {
+		char *end, *line, *save = NULL, *lsave = NULL, *method, *target, *proto, *query, *params, *body;
+		size_t head, length = 0, moff, toff;
+		gboolean keepalive = TRUE;
+
+		/* headers */
+		while (!(end = strstr(buf->str, "\r\n\r\n"))) {
+			if (buf->len > AURD_MAXREQUEST || http_fill(fd, buf, buf->len + 1))
+				goto done;
+		}
+		*end = '\0';
+		head = end + 4 - buf->str;
+		if (!(line = strtok_r(buf->str, "\r\n", &save)))
+			goto done;
+		method = strtok_r(line, " ", &lsave);
+		target = method ? strtok_r(NULL, " ", &lsave) : NULL;
+		proto = target ? strtok_r(NULL, " ", &lsave) : NULL;
+		if (!method || !target)
+			goto done;
+		/* reading the body can move the buffer */
+		moff = method - buf->str;
+		toff = target - buf->str;
+		if (proto && !strcmp(proto, "HTTP/1.0"))
+			keepalive = FALSE;
+		while ((line = strtok_r(NULL, "\r\n", &save))) {
+			if (!g_ascii_strncasecmp(line, "Content-Length:", 15))
+				length = strtoul(line + 15, NULL, 10);
+			else if (!g_ascii_strncasecmp(line, "Connection:", 11))
+				keepalive = !strstr(line + 11, "close");
+		}
+		if (length > AURD_MAXREQUEST)
+			goto done;
+		/* body */
+		if (http_fill(fd, buf, head + length))
+			goto done;
+		method = buf->str + moff;
+		target = buf->str + toff;
+		body = g_strndup(buf->str + head, length);
+		query = (query = strchr(target, '?')) ? query + 1 : NULL;
+		DPRINTF(1, "%s %s (%zu bytes)\n", method, target, length);
+		if (!strcmp(method, "POST"))
+			params = g_strdup(body);
+		else if (!strcmp(method, "GET"))
+			params = g_strdup(query ? : "");
+		else
+			params = NULL;
+		if (params) {
+			char *answer = rpc_answer(params);
+
+			if (http_respond(fd, 200, "OK", answer, keepalive))
+				keepalive = FALSE;
+			g_free(answer);
+			g_free(params);
+		} else {
+			http_respond(fd, 405, "Method Not Allowed", "{}", FALSE);
+			keepalive = FALSE;
+		}
+		g_free(body);
+		g_string_erase(buf, 0, head + length);
+		if (!keepalive)
+			break;
+	}
+      done:
+	g_string_free(buf, TRUE);
+	close(fd);
+	return (NULL);
+}
+
+/** @brief listen on options.listen and serve connections until killed */
+static int
+http_listen(void)
+{
+	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM, .ai_flags = AI_PASSIVE, };
+	struct addrinfo *res = NULL;
+	char *host, *port;
+	int fd, on = 1, err;
+
+	host = g_strdup(options.listen);
+	if ((port = strrchr(host, ':')))
+		*port++ = '\0';
+	else {
+		port = host;
+		host = g_strdup("");
+	}
+	if ((err = getaddrinfo(*host ? host : NULL, port, &hints, &res))) {
+		EPRINTF("Could not resolve %s: %s\n", options.listen, gai_strerror(err));
+		return (-1);
+	}
+	if ((fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol)) < 0
+	    || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on))
+	    || bind(fd, res->ai_addr, res->ai_addrlen) || listen(fd, SOMAXCONN)) {
+		EPRINTF("Could not listen on %s: %s\n", options.listen, strerror(errno));
+		freeaddrinfo(res);
+		return (-1);
+	}
+	freeaddrinfo(res);
+	OPRINTF(1, "Listening on http://%s/rpc/\n", options.listen);
+	for (;;) {
+		int conn;
+
+		if ((conn = accept(fd, NULL, NULL)) < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			EPRINTF("Could not accept: %s\n", strerror(errno));
+			close(fd);
+			return (-1);
+		}
+		setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		g_thread_unref(g_thread_new(NULL, http_serve, GINT_TO_POINTER(conn)));
+	}
+}
+
+/** @} */
+
+/** @section Main
+  * @{ */
+
+static void
+version(int argc, char *argv[])
+{
+	(void) argc;
+	(void) argv;
+	if (!options.output && !options.debug)
+		return;
+	(void) fprintf(stdout, "\
+%1$s (OpenSS7 %2$s) %3$s\n\
+Written by Brian Bidulock.\n\
+\n\
+Copyright (c) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020, 2021  Monavacon Limited.\n\
+Copyright (c) 2002, 2003, 2004, 2005, 2006, 2007, 2008, 2009  OpenSS7 Corporation.\n\
+Copyright (c) 1997, 1998, 1999, 2000, 2001  Brian F. G. Bidulock.\n\
+This is free software; see the source for copying conditions.  There is NO\n\
+warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\
+\n\
+Distributed by OpenSS7 under GNU Affero General Public License Version 3,\n\
+with conditions, incorporated herein by reference.\n\
+", NAME, PACKAGE, VERSION);
+}
+
+static void
+usage(int argc, char *argv[])
+{
+	(void) argc;
+	if (!options.output && !options.debug)
+		return;
+	(void) fprintf(stderr, "\
+Usage:\n\
+    %1$s [options]\n\
+    %1$s {-h|--help} [options]\n\
+    %1$s {-V|--version}\n\
+", argv[0]);
+}
+
+static void
+help(int argc, char *argv[])
+{
+	(void) argc;
+	if (!options.output && !options.debug)
+		return;
+	/* *INDENT-OFF* */
+	(void) fprintf(stdout, "\
+Usage:\n\
+    %1$s [options]\n\
+    %1$s {-h|--help} [options]\n\
+    %1$s {-V|--version}\n\
+Serve AUR RPC (version 5 info and multiinfo) requests locally, for use as\n\
+    pacana --aur=http://ADDRESS:PORT/rpc/\n\
+Options:\n\
+  Command Options:\n\
+    -h, --help, -?, --?\n\
+        print this usage information and exit\n\
+    -V, --version\n\
+        print version and exit\n\
+  Server Options:\n\
+    -l, --listen [ADDRESS:]PORT\n\
+        address and port on which to serve requests [default: %4$s]\n\
+    -d, --data FILE|DIRECTORY\n\
+        load packages from an AUR metadata dump FILE, or from the\n\
+        responses recorded in DIRECTORY by pacana --record; may be repeated\n\
+    -s, --synthetic PERCENT\n\
+        make up packages for this percentage of unknown names [default: %5$d]\n\
+    -L, --latency MILLISECONDS\n\
+        delay each response [default: %6$ld]\n\
+    -b, --bandwidth BYTES\n\
+        limit each connection to BYTES per second, 0 for unlimited [default: %7$ld]\n\
+  General Options:\n\
+    -D, --debug [LEVEL]\n\
+        increment or set debug LEVEL [default: '%2$d']\n\
+    -v, --verbose [LEVEL]\n\
+        increment or set output verbosity LEVEL [default: '%3$d']\n\
+        this option may be repeated.\n\
+", argv[0]
+	, options.debug
+	, options.output
+	, (options.listen ? : AURD_DEFAULT_LISTEN)
+	, options.synthetic
+	, options.latency
+	, options.bandwidth
+	);
+	/* *INDENT-ON* */
+}
+
+int
+main(int argc, char *argv[])
+{
+	Command command = CommandDefault;
+
+	setlocale(LC_ALL, "");
+
+	while (1) {
+		int c, val;
+		char *endptr = NULL;
+
+#ifdef _GNU_SOURCE
+		int option_index = 0;
+		/* *INDENT-OFF* */
+		static struct option long_options[] = {
+			{"listen",	required_argument,	NULL, 'l'},
+			{"data",	required_argument,	NULL, 'd'},
+			{"synthetic",	required_argument,	NULL, 's'},
+			{"latency",	required_argument,	NULL, 'L'},
+			{"bandwidth",	required_argument,	NULL, 'b'},
+
+			{"debug",	optional_argument,	NULL, 'D'},
+			{"verbose",	optional_argument,	NULL, 'v'},
+			{"help",	no_argument,		NULL, 'h'},
+			{"version",	no_argument,		NULL, 'V'},
+			{"?",		no_argument,		NULL, 'H'},
+			{ 0, }
+		};
+		/* *INDENT-ON* */
+
+		c = getopt_long_only(argc, argv, "l:d:s:L:b:D::v::hVH?", long_options, &option_index);
+#else				/* defined _GNU_SOURCE */
+		c = getopt(argc, argv, "l:d:s:L:b:DvhV?");
+#endif				/* defined _GNU_SOURCE */
+		if (c == -1) {
+			if (options.debug)
+				fprintf(stderr, "%s: done options processing\n", argv[0]);
+			break;
+		}
+		switch (c) {
+		case 0:
+			goto bad_usage;
+		case 'l':	/* -l, --listen [ADDRESS:]PORT */
+			free(options.listen);
+			options.listen = strdup(optarg);
+			break;
+		case 'd':	/* -d, --data FILE|DIRECTORY */
+			options.data = g_slist_append(options.data, strdup(optarg));
+			break;
+		case 's':	/* -s, --synthetic PERCENT */
+			val = strtoul(optarg, &endptr, 0);
+			if (*endptr || val < 0 || val > 100)
+				goto bad_option;
+			options.synthetic = val;
+			break;
+		case 'L':	/* -L, --latency MILLISECONDS */
+			options.latency = strtol(optarg, &endptr, 0);
+			if (*endptr || options.latency < 0)
+				goto bad_option;
+			break;
+		case 'b':	/* -b, --bandwidth BYTES */
+			options.bandwidth = strtol(optarg, &endptr, 0);
+			if (*endptr || options.bandwidth < 0)
+				goto bad_option;
+			break;
+		case 'D':	/* -D, --debug [LEVEL] */
+			if (options.debug)
+				fprintf(stderr, "%s: increasing debug verbosity\n", argv[0]);
+			if (optarg == NULL) {
+				options.debug++;
+			} else {
+				if ((val = strtol(optarg, &endptr, 0)) < 0)
+					goto bad_option;
+				if (*endptr)
+					goto bad_option;
+				options.debug = val;
+			}
+			break;
+		case 'v':	/* -v, --verbose [LEVEL] */
+			if (options.debug)
+				fprintf(stderr, "%s: increasing output verbosity\n", argv[0]);
+			if (optarg == NULL) {
+				options.output++;
+				break;
+			}
+			if ((val = strtol(optarg, &endptr, 0)) < 0)
+				goto bad_option;
+			if (*endptr)
+				goto bad_option;
+			options.output = val;
+			break;
+		case 'h':	/* -h, --help */
+		case 'H':	/* -H, --? */
+			command = CommandHelp;
+			break;
+		case 'V':	/* -V, --version */
+			if (options.command != CommandDefault)
+				goto bad_command;
+			if (command == CommandDefault)
+				command = CommandVersion;
+			options.command = CommandVersion;
+			break;
+		case '?':
+		default:
+		      bad_option:
+			optind--;
+		      bad_nonopt:
+			if (options.output || options.debug) {
+				if (optind < argc) {
+					fprintf(stderr, "%s: syntax error near '", argv[0]);
+					while (optind < argc)
+						fprintf(stderr, "%s ", argv[optind++]);
+					fprintf(stderr, "'\n");
+				} else {
+					fprintf(stderr, "%s: missing option or argument", argv[0]);
+					fprintf(stderr, "\n");
+				}
+				fflush(stderr);
+			      bad_usage:
+				usage(argc, argv);
+			}
+			exit(2);
+		      bad_command:
+			fprintf(stderr, "%s: only one command option allowed\n", argv[0]);
+			goto bad_usage;
+		}
+	}
+	if (optind < argc)
+		goto bad_nonopt;
+
+	switch (command) {
+	case CommandHelp:
+		help(argc, argv);
+		exit(EXIT_SUCCESS);
+	case CommandVersion:
+		version(argc, argv);
+		exit(EXIT_SUCCESS);
+	case CommandDefault:
+		options.command = command = CommandServe;
+		/* fall thru */
+	case CommandServe:
+		if (!options.listen)
+			options.listen = strdup(AURD_DEFAULT_LISTEN);
+		signal(SIGPIPE, SIG_IGN);
+		if (store_load())
+			exit(EXIT_FAILURE);
+		if (http_listen())
+			exit(EXIT_FAILURE);
+		exit(EXIT_SUCCESS);
+	}
+	EPRINTF("invalid command\n");
+	exit(EXIT_FAILURE);
+}
+
+/** @} */
+
+// vim: set sw=8 tw=80 com=srO\:/**,mb\:*,ex\:*/,srO\:/*,mb\:*,ex\:*/,b\:TRANS foldmarker=@{,@} foldmethod=marker:
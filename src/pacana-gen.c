@@ -0,0 +1,996 @@
+/*****************************************************************************
+
+ Copyright (c) 2010-2021  Monavacon Limited <http://www.monavacon.com/>
+ Copyright (c) 2002-2009  OpenSS7 Corporation <http://www.openss7.com/>
+ Copyright (c) 1997-2001  Brian F. G. Bidulock <bidulock@openss7.org>
+
+ All Rights Reserved.
+
+ This program is free software: you can redistribute it and/or modify it under
+ the terms of the GNU General Public License as published by the Free Software
+ Foundation, version 3 of the license.
+
+ This program is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ details.
+
+ You should have received a copy of the GNU General Public License along with
+ this program.  If not, see <http://www.gnu.org/licenses/>, or write to the
+ Free Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+ -----------------------------------------------------------------------------
+
+ U.S. GOVERNMENT RESTRICTED RIGHTS.  If you are licensing this Software on
+ behalf of the U.S. Government ("Government"), the following provisions apply
+ to you.  If the Software is supplied by the Department of Defense ("DoD"), it
+ is classified as "Commercial Computer Software" under paragraph 252.227-7014
+ of the DoD Supplement to the Federal Acquisition Regulations ("DFARS") (or any
+ successor regulations) and the Government is acquiring only the license rights
+ granted herein (the license rights customarily provided to non-Government
+ users).  If the Software is supplied to any unit or agency of the Government
+ other than DoD, it is classified as "Restricted Computer Software" and the
+ Government's rights in the Software are defined in paragraph 52.227-19 of the
+ Federal Acquisition Regulations ("FAR") (or any successor regulations) or, in
+ the cases of NASA, in paragraph 18.52.227-86 of the NASA Supplement to the FAR
+ (or any successor regulations).
+
+ -----------------------------------------------------------------------------
+
+ Commercial licensing and support of this software is available from OpenSS7
+ Corporation at a fee.  See http://www.openss7.com/
+
+ *****************************************************************************/
+
+/*
+ * A generator of synthetic installation roots, for timing pacana on databases
+ * of any size.  It writes a pacman.conf, a local database and a number of
+ * sync database archives, with the density of provisions, conflicts and
+ * dependencies, and the proportions of shadowed, VCS, out of date, foreign
+ * and missing packages, set by options, so that all analyses have something
+ * to find.  The same options and seed always generate the same root.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "autoconf.h"
+#endif
+
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+
+/** @section Includes
+  * @{ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _GNU_SOURCE
+#include <getopt.h>
+#endif
+#include <time.h>
+#include <sys/time.h>
+#include <locale.h>
+
+#include <glib.h>
+
+#include <zlib.h>
+
+/** @} */
+
+/** @section Debugging Preamble
+  * @{ */
+
+const char *
+_timestamp(void)
+{
+	static __thread struct timeval tv = { 0, 0 };
+	static __thread struct tm tm = { 0, };
+	static __thread char buf[BUFSIZ];
+	size_t len;
+
+	gettimeofday(&tv, NULL);
+	len = strftime(buf, sizeof(buf) - 1, "%b %d %T", gmtime_r(&tv.tv_sec, &tm));
+	snprintf(buf + len, sizeof(buf) - len - 1, ".%06ld", tv.tv_usec);
+	return buf;
+}
+
+#define DPRINTF(_num, _args...) do { if (options.debug >= _num) { \
+		fprintf(stderr, NAME "[%d]: D: [%s] %12s: +%4d : %s() : ", getpid(), _timestamp(), __FILE__, __LINE__, __func__); \
+		fprintf(stderr, _args); fflush(stderr); } } while (0)
+
+#define EPRINTF(_args...) do { \
+		fprintf(stderr, NAME "[%d]: E: [%s] %12s +%4d : %s() : ", getpid(), _timestamp(), __FILE__, __LINE__, __func__); \
+		fprintf(stderr, _args); fflush(stderr); } while (0)
+
+#define OPRINTF(_num, _args...) do { if (options.debug >= _num || options.output > _num) { \
+		fprintf(stdout, _args); fflush(stdout); } } while (0)
+
+/** @} */
+
+/** @section Definitions
+  * @{ */
+
+typedef enum {
+	CommandDefault,
+	CommandGenerate,
+	CommandHelp,
+	CommandVersion,
+} Command;
+
+#define ARCH_STANDARD_REPOS	    "core,extra,community,multilib,ec2,testing,community-testing,multilib-testing"
+
+typedef struct {
+	int debug;
+	int output;
+	Command command;
+	char *root;
+	int packages;
+	int repos;
+	int custom;
+	int local;
+	int foreign;
+	double provides;
+	double conflicts;
+	double depends;
+	int shadow;
+	int vcs;
+	int outdated;
+	int missing;
+	guint32 seed;
+} Options;
+
+Options options = {
+	.debug = 0,
+	.output = 1,
+	.command = CommandDefault,
+	.root = NULL,
+	.packages = 1000,
+	.repos = 3,
+	.custom = 1,
+	.local = 50,
+	.foreign = 5,
+	.provides = 0.3,
+	.conflicts = 0.05,
+	.depends = 3.0,
+	.shadow = 5,
+	.vcs = 3,
+	.outdated = 10,
+	.missing = 1,
+	.seed = 1,
+};
+
+struct genpkg {
+	char *name;
+	char *version;
+	GPtrArray *provides;		/* of char * */
+	GPtrArray *conflicts;		/* of char * */
+	GPtrArray *depends;		/* of char * */
+};
+
+struct genrepo {
+	char *name;
+	GPtrArray *pkgs;		/* of struct genpkg * */
+};
+
+GRand *rnd = NULL;
+
+/** @} */
+
+/** @section Generator
+  * @{ */
+
+/** @brief whether an event of a percentage chance happens */
+static gboolean
+gen_chance(int percent)
+{
+	return (g_rand_int_range(rnd, 0, 100) < percent);
+}
+
+/** @brief a count of an average density: its integer part, plus one by the
+  * chance of its fractional part
+  */
+static int
+gen_count(double density)
+{
+	int count = (int) density;
+
+	if (g_rand_double(rnd) < density - count)
+		count++;
+	return (count);
+}
+
+static char *
+gen_version(void)
+{
+	return (g_strdup_printf("%d.%d.%d-%d", g_rand_int_range(rnd, 1, 10), g_rand_int_range(rnd, 0, 20),
+				g_rand_int_range(rnd, 0, 10), g_rand_int_range(rnd, 1, 4)));
+}
+
+static struct genpkg *
+gen_pkg(const char *name, char *version)
+{
+	struct genpkg *pkg = calloc(1, sizeof(*pkg));
+
+	pkg->name = g_strdup(name);
+	pkg->version = version;
+	pkg->provides = g_ptr_array_new_with_free_func(g_free);
+	pkg->conflicts = g_ptr_array_new_with_free_func(g_free);
+	pkg->depends = g_ptr_array_new_with_free_func(g_free);
+	return (pkg);
+}
+
+static void
+gen_pkg_free(gpointer data)
+{
+	struct genpkg *pkg = data;
+
+	g_ptr_array_free(pkg->depends, TRUE);
+	g_ptr_array_free(pkg->conflicts, TRUE);
+	g_ptr_array_free(pkg->provides, TRUE);
+	g_free(pkg->version);
+	g_free(pkg->name);
+	free(pkg);
+}
+
+/** @brief a new package name, a VCS package by the chance of options.vcs */
+static char *
+gen_name(const char *prefix, guint *id)
+{
+	static const char *vcs[] = { "git", "git", "git", "svn", "cvs", "bzr" };
+
+	if (gen_chance(options.vcs))
+		return (g_strdup_printf("%s%u-%s", prefix, (*id)++, vcs[g_rand_int_range(rnd, 0, G_N_ELEMENTS(vcs))]));
+	return (g_strdup_printf("%s%u", prefix, (*id)++));
+}
+
+/** @brief name the sync databases: standard repositories first, then custom
+  * ones
+  */
+static char *
+gen_repo_name(int r)
+{
+	int nstandard = options.repos - options.custom;
+
+	if (r < nstandard) {
+		char **names = g_strsplit(ARCH_STANDARD_REPOS, ",", -1), *name;
+
+		name = g_strdup(names[r]);
+		g_strfreev(names);
+		return (name);
+	}
+	if (r == nstandard)
+		return (g_strdup("custom"));
+	return (g_strdup_printf("custom%d", r - nstandard + 1));
+}
+
+/** @brief generate the packages of the sync databases
+  *
+  * Packages are spread evenly over the databases.  Past the first database,
+  * options.shadow percent of them take the name of a package of an earlier
+  * database, each name at most once per database.  Provisions are of a pool
+  * of virtual names, or of the name of another package; conflicts are with
+  * either; dependencies are on either, and options.missing percent of them are
+  * on names that nothing provides.
+  */
+static GPtrArray *
+gen_sync(GPtrArray *names)
+{
+	GPtrArray *repos = g_ptr_array_new();
+	guint id = 1, nvirtual = MAX(options.packages / 20, 1), i, j, r, k;
+
+	for (r = 0; r < (guint) options.repos; r++) {
+		struct genrepo *repo = calloc(1, sizeof(*repo));
+		guint count = options.packages / options.repos + (r < (guint) options.packages % options.repos);
+		guint earlier = names->len;	/* names of the earlier databases */
+		GHashTable *shadowed = g_hash_table_new(g_str_hash, g_str_equal);
+
+		repo->name = gen_repo_name(r);
+		repo->pkgs = g_ptr_array_new_with_free_func(gen_pkg_free);
+		for (i = 0; i < count; i++) {
+			const char *other = NULL;
+			char *name;
+
+			if (earlier && gen_chance(options.shadow))
+				other = g_ptr_array_index(names, g_rand_int_range(rnd, 0, earlier));
+			if (other && g_hash_table_add(shadowed, (gpointer) other))
+				name = g_strdup(other);
+			else {
+				name = gen_name("pkg", &id);
+				g_ptr_array_add(names, g_strdup(name));
+			}
+			g_ptr_array_add(repo->pkgs, gen_pkg(name, gen_version()));
+			g_free(name);
+		}
+		g_hash_table_destroy(shadowed);
+		g_ptr_array_add(repos, repo);
+	}
+	/* relations may be with any package, once all are named */
+	for (r = 0; r < repos->len; r++) {
+		struct genrepo *repo = g_ptr_array_index(repos, r);
+
+		for (i = 0; i < repo->pkgs->len; i++) {
+			struct genpkg *pkg = g_ptr_array_index(repo->pkgs, i);
+			const char *other;
+
+			for (j = gen_count(options.provides); j; j--) {
+				if (gen_chance(70))
+					g_ptr_array_add(pkg->provides, g_strdup_printf("virtual%u%s",
+										 g_rand_int_range(rnd, 0, nvirtual),
+										 gen_chance(50) ? "=1.0" : ""));
+				else if (strcmp((other = g_ptr_array_index(names, g_rand_int_range(rnd, 0, names->len))),
+						pkg->name))
+					g_ptr_array_add(pkg->provides, g_strdup(other));
+			}
+			for (j = gen_count(options.conflicts); j; j--) {
+				if (gen_chance(50))
+					g_ptr_array_add(pkg->conflicts, g_strdup_printf("virtual%u",
+										  g_rand_int_range(rnd, 0, nvirtual)));
+				else if (strcmp((other = g_ptr_array_index(names, g_rand_int_range(rnd, 0, names->len))),
+						pkg->name))
+					g_ptr_array_add(pkg->conflicts, g_strdup(other));
+			}
+			for (j = gen_count(options.depends); j; j--) {
+				k = g_rand_int_range(rnd, 0, 100);
+				if (k < (guint) options.missing)
+					g_ptr_array_add(pkg->depends, g_strdup_printf("missing%u",
+										g_rand_int_range(rnd, 0, nvirtual)));
+				else if (k < 80)
+					g_ptr_array_add(pkg->depends,
+							g_strdup(g_ptr_array_index(names, g_rand_int_range(rnd, 0, names->len))));
+				else
+					g_ptr_array_add(pkg->depends, g_strdup_printf("virtual%u",
+										g_rand_int_range(rnd, 0, nvirtual)));
+			}
+		}
+	}
+	return (repos);
+}
+
+/** @brief generate the packages of the local database
+  *
+  * options.local percent of the names of the sync databases are installed, at
+  * the version of the first database that has them or, options.outdated
+  * percent of the time, at an older one; then options.foreign percent more
+  * packages that no sync database has.
+  */
+static GPtrArray *
+gen_local(GPtrArray *repos)
+{
+	GPtrArray *pkgs = g_ptr_array_new_with_free_func(gen_pkg_free);
+	GHashTable *seen = g_hash_table_new(g_str_hash, g_str_equal);
+	guint id = 1, r, i, j, nforeign;
+
+	for (r = 0; r < repos->len; r++) {
+		struct genrepo *repo = g_ptr_array_index(repos, r);
+
+		for (i = 0; i < repo->pkgs->len; i++) {
+			struct genpkg *sync = g_ptr_array_index(repo->pkgs, i), *pkg;
+
+			if (g_hash_table_contains(seen, sync->name))
+				continue;
+			g_hash_table_add(seen, sync->name);
+			if (!gen_chance(options.local))
+				continue;
+			pkg = gen_pkg(sync->name, gen_chance(options.outdated) ? g_strdup("0.1-1") : g_strdup(sync->version));
+			for (j = 0; j < sync->provides->len; j++)
+				g_ptr_array_add(pkg->provides, g_strdup(g_ptr_array_index(sync->provides, j)));
+			for (j = 0; j < sync->conflicts->len; j++)
+				g_ptr_array_add(pkg->conflicts, g_strdup(g_ptr_array_index(sync->conflicts, j)));
+			for (j = 0; j < sync->depends->len; j++)
+				g_ptr_array_add(pkg->depends, g_strdup(g_ptr_array_index(sync->depends, j)));
+			g_ptr_array_add(pkgs, pkg);
+		}
+	}
+	g_hash_table_destroy(seen);
+	for (nforeign = pkgs->len * options.foreign / 100; nforeign; nforeign--) {
+		char *name = gen_name("foreign", &id);
+
+		g_ptr_array_add(pkgs, gen_pkg(name, gen_version()));
+		g_free(name);
+	}
+	return (pkgs);
+}
+
+/** @} */
+
+/** @section Writer
+  * @{ */
+
+static void
+desc_list(GString *desc, const char *field, GPtrArray *values)
+{
+	guint i;
+
+	if (!values->len)
+		return;
+	g_string_append_printf(desc, "%%%s%%\n", field);
+	for (i = 0; i < values->len; i++)
+		g_string_append_printf(desc, "%s\n", (char *) g_ptr_array_index(values, i));
+	g_string_append_c(desc, '\n');
+}
+
+/** @brief the desc file of a package in a local or sync database */
+static GString *
+desc_new(struct genpkg *pkg, gboolean local)
+{
+	GString *desc = g_string_new(NULL);
+
+	if (!local)
+		g_string_append_printf(desc, "%%FILENAME%%\n%s-%s-x86_64.pkg.tar.zst\n\n", pkg->name, pkg->version);
+	g_string_append_printf(desc, "%%NAME%%\n%s\n\n", pkg->name);
+	g_string_append_printf(desc, "%%BASE%%\n%s\n\n", pkg->name);
+	g_string_append_printf(desc, "%%VERSION%%\n%s\n\n", pkg->version);
+	g_string_append_printf(desc, "%%DESC%%\nsynthetic package %s\n\n", pkg->name);
+	if (!local)
+		g_string_append(desc, "%CSIZE%\n1024\n\n");
+	g_string_append(desc, local ? "%SIZE%\n4096\n\n" : "%ISIZE%\n4096\n\n");
+	g_string_append(desc, "%ARCH%\nx86_64\n\n");
+	g_string_append(desc, "%BUILDDATE%\n1600000000\n\n");
+	if (local)
+		g_string_append(desc, "%INSTALLDATE%\n1600000000\n\n");
+	g_string_append(desc, "%PACKAGER%\nSynthetic Packager <synthetic@example.com>\n\n");
+	if (local)
+		g_string_append(desc, "%REASON%\n1\n\n");
+	desc_list(desc, "DEPENDS", pkg->depends);
+	desc_list(desc, "CONFLICTS", pkg->conflicts);
+	desc_list(desc, "PROVIDES", pkg->provides);
+	return (desc);
+}
+
+/** @brief write a ustar header for an entry of an archive */
+static int
+tar_header(gzFile gz, const char *name, size_t size, char type)
+{
+	unsigned char block[512] = { 0, };
+	unsigned sum = 0;
+	size_t i;
+
+	if (strlen(name) >= 100) {
+		EPRINTF("Name too long for archive: %s\n", name);
+		return (-1);
+	}
+	memcpy(block, name, strlen(name));
+	snprintf((char *) block + 100, 8, "%07o", type == '5' ? 0755 : 0644);
+	snprintf((char *) block + 108, 8, "%07o", 0);
+	snprintf((char *) block + 116, 8, "%07o", 0);
+	snprintf((char *) block + 124, 12, "%011zo", size);
+	snprintf((char *) block + 136, 12, "%011o", 1600000000);
+	block[156] = type;
+	memcpy(block + 257, "ustar", 6);
+	memcpy(block + 263, "00", 2);
+	memset(block + 148, ' ', 8);
+	for (i = 0; i < sizeof(block); i++)
+		sum += block[i];
+	snprintf((char *) block + 148, 8, "%06o", sum);
+	return (gzwrite(gz, block, sizeof(block)) == sizeof(block) ? 0 : -1);
+}
+
+/** @brief write a file entry of an archive, padded to a whole block */
+static int
+tar_file(gzFile gz, const char *name, const char *data, size_t len)
+{
+	static const char zeros[512] = { 0, };
+	size_t pad = (512 - len % 512) % 512;
+
+	if (tar_header(gz, name, len, '0'))
+		return (-1);
+	if (len && gzwrite(gz, data, len) != (int) len)
+		return (-1);
+	if (pad && gzwrite(gz, zeros, pad) != (int) pad)
+		return (-1);
+	return (0);
+}
+
+/** @brief write a sync database as a gzip compressed tar archive */
+static int
+write_sync(const char *dir, struct genrepo *repo)
+{
+	static const char zeros[1024] = { 0, };
+	char *file = g_strdup_printf("%s/%s.db", dir, repo->name), *entry;
+	gzFile gz;
+	guint i;
+	int err = 0;
+
+	if (!(gz = gzopen(file, "wb6"))) {
+		EPRINTF("Could not create %s: %s\n", file, strerror(errno));
+		g_free(file);
+		return (-1);
+	}
+	for (i = 0; !err && i < repo->pkgs->len; i++) {
+		struct genpkg *pkg = g_ptr_array_index(repo->pkgs, i);
+		GString *desc = desc_new(pkg, FALSE);
+
+		entry = g_strdup_printf("%s-%s/", pkg->name, pkg->version);
+		err = tar_header(gz, entry, 0, '5');
+		g_free(entry);
+		entry = g_strdup_printf("%s-%s/desc", pkg->name, pkg->version);
+		if (!err)
+			err = tar_file(gz, entry, desc->str, desc->len);
+		g_free(entry);
+		g_string_free(desc, TRUE);
+	}
+	if (!err && gzwrite(gz, zeros, sizeof(zeros)) != sizeof(zeros))
+		err = -1;
+	if (gzclose(gz) != Z_OK)
+		err = -1;
+	if (err)
+		EPRINTF("Could not write %s\n", file);
+	g_free(file);
+	return (err);
+}
+
+/** @brief write the local database as a directory per package */
+static int
+write_local(const char *dir, GPtrArray *pkgs)
+{
+	GError *error = NULL;
+	char *path, *file;
+	guint i;
+	int err = 0;
+
+	file = g_build_filename(dir, "ALPM_DB_VERSION", NULL);
+	if (!g_file_set_contents(file, "9\n", -1, &error))
+		err = -1;
+	g_free(file);
+	for (i = 0; !err && i < pkgs->len; i++) {
+		struct genpkg *pkg = g_ptr_array_index(pkgs, i);
+		GString *desc = desc_new(pkg, TRUE);
+
+		path = g_strdup_printf("%s/%s-%s", dir, pkg->name, pkg->version);
+		file = g_build_filename(path, "desc", NULL);
+		if (g_mkdir_with_parents(path, 0755) || !g_file_set_contents(file, desc->str, desc->len, &error))
+			err = -1;
+		g_free(file);
+		g_free(path);
+		g_string_free(desc, TRUE);
+	}
+	if (err) {
+		EPRINTF("Could not write local database in %s: %s\n", dir, error ? error->message : strerror(errno));
+		g_clear_error(&error);
+	}
+	return (err);
+}
+
+static int
+write_config(const char *file, GPtrArray *repos)
+{
+	GString *conf = g_string_new("[options]\nArchitecture = x86_64\n");
+	GError *error = NULL;
+	guint r;
+	int err = 0;
+
+	for (r = 0; r < repos->len; r++)
+		g_string_append_printf(conf, "\n[%s]\nServer = file:///nonexistent/$repo\n",
+				       ((struct genrepo *) g_ptr_array_index(repos, r))->name);
+	if (!g_file_set_contents(file, conf->str, conf->len, &error)) {
+		EPRINTF("Could not write %s: %s\n", file, error->message);
+		g_error_free(error);
+		err = -1;
+	}
+	g_string_free(conf, TRUE);
+	return (err);
+}
+
+/** @brief generate a root and write it under options.root */
+static int
+generate(void)
+{
+	char *etc = g_build_filename(options.root, "etc", NULL);
+	char *conf = g_build_filename(etc, "pacman.conf", NULL);
+	char *local = g_build_filename(options.root, "var/lib/pacman/local", NULL);
+	char *sync = g_build_filename(options.root, "var/lib/pacman/sync", NULL);
+	GPtrArray *names = g_ptr_array_new_with_free_func(g_free), *repos, *pkgs;
+	guint r;
+	int err = 0;
+
+	rnd = g_rand_new_with_seed(options.seed);
+	repos = gen_sync(names);
+	pkgs = gen_local(repos);
+	if (g_mkdir_with_parents(etc, 0755) || g_mkdir_with_parents(local, 0755) || g_mkdir_with_parents(sync, 0755)) {
+		EPRINTF("Could not create directories under %s: %s\n", options.root, strerror(errno));
+		err = -1;
+	}
+	if (!err)
+		err = write_config(conf, repos);
+	for (r = 0; !err && r < repos->len; r++)
+		err = write_sync(sync, g_ptr_array_index(repos, r));
+	if (!err)
+		err = write_local(local, pkgs);
+	if (!err)
+		OPRINTF(1, "Generated %s: %d packages in %d sync databases, %u installed\n", options.root,
+			options.packages, options.repos, pkgs->len);
+	for (r = 0; r < repos->len; r++) {
+		struct genrepo *repo = g_ptr_array_index(repos, r);
+
+		g_ptr_array_free(repo->pkgs, TRUE);
+		g_free(repo->name);
+		free(repo);
+	}
+	g_ptr_array_free(repos, TRUE);
+	g_ptr_array_free(pkgs, TRUE);
+	g_ptr_array_free(names, TRUE);
+	g_rand_free(rnd);
+	g_free(sync);
+	g_free(local);
+	g_free(conf);
+	g_free(etc);
+	return (err);
+}
+
+/** @} */
+
+/** @section Main
+  * @{ */
+
+static void
+version(int argc, char *argv[])
+{
+	(void) argc;
+	(void) argv;
+	if (!options.output && !options.debug)
+		return;
+	(void) fprintf(stdout, "\
+%1$s (OpenSS7 %2$s) %3$s\n\
+Written by Brian Bidulock.\n\
+\n\
+Copyright (c) 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018, 2019, 2020, 2021  Monavacon Limited.\n\
+Copyright (c) 2002, 2003, 2004, 2005, 2006, 2007, 2008, 2009  OpenSS7 Corporation.\n\
+Copyright (c) 1997, 1998, 1999, 2000, 2001  Brian F. G. Bidulock.\n\
+This is free software; see the source for copying conditions.  There is NO\n\
+warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n\
+\n\
+Distributed by OpenSS7 under GNU Affero General Public License Version 3,\n\
+with conditions, incorporated herein by reference.\n\
+", NAME, PACKAGE, VERSION);
+}
+
+static void
+usage(int argc, char *argv[])
+{
+	(void) argc;
+	if (!options.output && !options.debug)
+		return;
+	(void) fprintf(stderr, "\
+Usage:\n\
+    %1$s --root DIRECTORY [options]\n\
+    %1$s {-h|--help} [options]\n\
+    %1$s {-V|--version}\n\
+", argv[0]);
+}
+
+static void
+help(int argc, char *argv[])
+{
+	(void) argc;
+	if (!options.output && !options.debug)
+		return;
+	/* *INDENT-OFF* */
+	(void) fprintf(stdout, "\
+Usage:\n\
+    %1$s --root DIRECTORY [options]\n\
+    %1$s {-h|--help} [options]\n\
+    %1$s {-V|--version}\n\
+Generate a synthetic installation root, for use as\n\
+    pacana --root DIRECTORY\n\
+Options:\n\
+  Command Options:\n\
+    -h, --help, -?, --?\n\
+        print this usage information and exit\n\
+    -V, --version\n\
+        print version and exit\n\
+  Generator Options:\n\
+    -r, --root DIRECTORY\n\
+        directory in which to generate the root\n\
+    -p, --packages PACKAGES\n\
+        packages in all sync databases [default: %4$d]\n\
+    -s, --repos REPOSITORIES\n\
+        number of sync databases [default: %5$d]\n\
+    -c, --custom REPOSITORIES\n\
+        how many of them are custom [default: %6$d]\n\
+    --local PERCENT\n\
+        of the packages of sync databases that are installed [default: %7$d]\n\
+    --foreign PERCENT\n\
+        more installed packages that are in no sync database [default: %8$d]\n\
+    --provides DENSITY\n\
+        average provisions per package [default: %9$g]\n\
+    --conflicts DENSITY\n\
+        average conflicts per package [default: %10$g]\n\
+    --depends DENSITY\n\
+        average dependencies per package [default: %11$g]\n\
+    --shadow PERCENT\n\
+        of the packages of later sync databases named as in earlier ones [default: %12$d]\n\
+    --vcs PERCENT\n\
+        of packages that are VCS packages [default: %13$d]\n\
+    --outdated PERCENT\n\
+        of installed packages older than in sync databases [default: %14$d]\n\
+    --missing PERCENT\n\
+        of dependencies that nothing provides [default: %15$d]\n\
+    --seed SEED\n\
+        seed of the random choices [default: %16$u]\n\
+  General Options:\n\
+    -D, --debug [LEVEL]\n\
+        increment or set debug LEVEL [default: '%2$d']\n\
+    -v, --verbose [LEVEL]\n\
+        increment or set output verbosity LEVEL [default: '%3$d']\n\
+        this option may be repeated.\n\
+", argv[0]
+	, options.debug
+	, options.output
+	, options.packages
+	, options.repos
+	, options.custom
+	, options.local
+	, options.foreign
+	, options.provides
+	, options.conflicts
+	, options.depends
+	, options.shadow
+	, options.vcs
+	, options.outdated
+	, options.missing
+	, options.seed
+	);
+	/* *INDENT-ON* */
+}
+
+/** @brief parse a percentage option argument */
+static int
+get_percent(const char *arg, int *percent)
+{
+	char *endptr = NULL;
+	long val = strtol(arg, &endptr, 0);
+
+	if (*endptr || val < 0 || val > 100)
+		return (-1);
+	*percent = val;
+	return (0);
+}
+
+/** @brief parse a density option argument */
+static int
+get_density(const char *arg, double *density)
+{
+	char *endptr = NULL;
+	double val = strtod(arg, &endptr);
+
+	if (*endptr || val < 0)
+		return (-1);
+	*density = val;
+	return (0);
+}
+
+/* codes of the long options that have no short option */
+enum {
+	OptionLocal = 256,
+	OptionForeign,
+	OptionProvides,
+	OptionConflicts,
+	OptionDepends,
+	OptionShadow,
+	OptionVcs,
+	OptionOutdated,
+	OptionMissing,
+	OptionSeed,
+};
+
+int
+main(int argc, char *argv[])
+{
+	Command command = CommandDefault;
+
+	setlocale(LC_ALL, "");
+
+	while (1) {
+		int c, val;
+		char *endptr = NULL;
+
+#ifdef _GNU_SOURCE
+		int option_index = 0;
+		/* *INDENT-OFF* */
+		static struct option long_options[] = {
+			{"root",	required_argument,	NULL, 'r'},
+			{"packages",	required_argument,	NULL, 'p'},
+			{"repos",	required_argument,	NULL, 's'},
+			{"custom",	required_argument,	NULL, 'c'},
+			{"local",	required_argument,	NULL, OptionLocal},
+			{"foreign",	required_argument,	NULL, OptionForeign},
+			{"provides",	required_argument,	NULL, OptionProvides},
+			{"conflicts",	required_argument,	NULL, OptionConflicts},
+			{"depends",	required_argument,	NULL, OptionDepends},
+			{"shadow",	required_argument,	NULL, OptionShadow},
+			{"vcs",		required_argument,	NULL, OptionVcs},
+			{"outdated",	required_argument,	NULL, OptionOutdated},
+			{"missing",	required_argument,	NULL, OptionMissing},
+			{"seed",	required_argument,	NULL, OptionSeed},
+
+			{"debug",	optional_argument,	NULL, 'D'},
+			{"verbose",	optional_argument,	NULL, 'v'},
+			{"help",	no_argument,		NULL, 'h'},
+			{"version",	no_argument,		NULL, 'V'},
+			{"?",		no_argument,		NULL, 'H'},
+			{ 0, }
+		};
+		/* *INDENT-ON* */
+
+		c = getopt_long_only(argc, argv, "r:p:s:c:D::v::hVH?", long_options,
+				     &option_index);
+#else				/* defined _GNU_SOURCE */
+		c = getopt(argc, argv, "r:p:s:c:DvhV?");
+#endif				/* defined _GNU_SOURCE */
+		if (c == -1) {
+			if (options.debug)
+				fprintf(stderr, "%s: done options processing\n", argv[0]);
+			break;
+		}
+		switch (c) {
+		case 0:
+			goto bad_usage;
+		case 'r':	/* -r, --root DIRECTORY */
+			free(options.root);
+			options.root = strdup(optarg);
+			break;
+		case 'p':	/* -p, --packages PACKAGES */
+			val = strtol(optarg, &endptr, 0);
+			if (*endptr || val < 1)
+				goto bad_option;
+			options.packages = val;
+			break;
+		case 's':	/* -s, --repos REPOSITORIES */
+			val = strtol(optarg, &endptr, 0);
+			if (*endptr || val < 1)
+				goto bad_option;
+			options.repos = val;
+			break;
+		case 'c':	/* -c, --custom REPOSITORIES */
+			val = strtol(optarg, &endptr, 0);
+			if (*endptr || val < 0)
+				goto bad_option;
+			options.custom = val;
+			break;
+		case OptionLocal:	/* --local PERCENT */
+			if (get_percent(optarg, &options.local))
+				goto bad_option;
+			break;
+		case OptionForeign:	/* --foreign PERCENT */
+			if (get_percent(optarg, &options.foreign))
+				goto bad_option;
+			break;
+		case OptionProvides:	/* --provides DENSITY */
+			if (get_density(optarg, &options.provides))
+				goto bad_option;
+			break;
+		case OptionConflicts:	/* --conflicts DENSITY */
+			if (get_density(optarg, &options.conflicts))
+				goto bad_option;
+			break;
+		case OptionDepends:	/* --depends DENSITY */
+			if (get_density(optarg, &options.depends))
+				goto bad_option;
+			break;
+		case OptionShadow:	/* --shadow PERCENT */
+			if (get_percent(optarg, &options.shadow))
+				goto bad_option;
+			break;
+		case OptionVcs:	/* --vcs PERCENT */
+			if (get_percent(optarg, &options.vcs))
+				goto bad_option;
+			break;
+		case OptionOutdated:	/* --outdated PERCENT */
+			if (get_percent(optarg, &options.outdated))
+				goto bad_option;
+			break;
+		case OptionMissing:	/* --missing PERCENT */
+			if (get_percent(optarg, &options.missing))
+				goto bad_option;
+			break;
+		case OptionSeed:	/* --seed SEED */
+			options.seed = strtoul(optarg, &endptr, 0);
+			if (*endptr)
+				goto bad_option;
+			break;
+		case 'D':	/* -D, --debug [LEVEL] */
+			if (options.debug)
+				fprintf(stderr, "%s: increasing debug verbosity\n", argv[0]);
+			if (optarg == NULL) {
+				options.debug++;
+			} else {
+				if ((val = strtol(optarg, &endptr, 0)) < 0)
+					goto bad_option;
+				if (*endptr)
+					goto bad_option;
+				options.debug = val;
+			}
+			break;
+		case 'v':	/* -v, --verbose [LEVEL] */
+			if (options.debug)
+				fprintf(stderr, "%s: increasing output verbosity\n", argv[0]);
+			if (optarg == NULL) {
+				options.output++;
+				break;
+			}
+			if ((val = strtol(optarg, &endptr, 0)) < 0)
+				goto bad_option;
+			if (*endptr)
+				goto bad_option;
+			options.output = val;
+			break;
+		case 'h':	/* -h, --help */
+		case 'H':	/* -H, --? */
+			command = CommandHelp;
+			break;
+		case 'V':	/* -V, --version */
+			if (options.command != CommandDefault)
+				goto bad_command;
+			if (command == CommandDefault)
+				command = CommandVersion;
+			options.command = CommandVersion;
+			break;
+		case '?':
+		default:
+		      bad_option:
+			optind--;
+		      bad_nonopt:
+			if (options.output || options.debug) {
+				if (optind < argc) {
+					fprintf(stderr, "%s: syntax error near '", argv[0]);
+					while (optind < argc)
+						fprintf(stderr, "%s ", argv[optind++]);
+					fprintf(stderr, "'\n");
+				} else {
+					fprintf(stderr, "%s: missing option or argument", argv[0]);
+					fprintf(stderr, "\n");
+				}
+				fflush(stderr);
+			      bad_usage:
+				usage(argc, argv);
+			}
+			exit(2);
+		      bad_command:
+			fprintf(stderr, "%s: only one command option allowed\n", argv[0]);
+			goto bad_usage;
+		}
+	}
+	if (optind < argc)
+		goto bad_nonopt;
+
+	switch (command) {
+	case CommandHelp:
+		help(argc, argv);
+		exit(EXIT_SUCCESS);
+	case CommandVersion:
+		version(argc, argv);
+		exit(EXIT_SUCCESS);
+	case CommandDefault:
+		options.command = command = CommandGenerate;
+		/* fall thru */
+	case CommandGenerate:
+		if (!options.root) {
+			fprintf(stderr, "%s: --root is required\n", argv[0]);
+			goto bad_usage;
+		}
+		if (options.custom > options.repos) {
+			fprintf(stderr, "%s: more custom than sync databases\n", argv[0]);
+			goto bad_usage;
+		}
+		if (options.repos - options.custom > 8) {
+			fprintf(stderr, "%s: at most 8 sync databases may be standard\n", argv[0]);
+			goto bad_usage;
+		}
+		if (generate())
+			exit(EXIT_FAILURE);
+		exit(EXIT_SUCCESS);
+	}
+	EPRINTF("invalid command\n");
+	exit(EXIT_FAILURE);
+}
+
+/** @} */
+
+// vim: set sw=8 tw=80 com=srO\:/**,mb\:*,ex\:*/,srO\:/*,mb\:*,ex\:*/,b\:TRANS foldmarker=@{,@} foldmethod=marker:
@@ -69,6 +69,9 @@
 #include <sys/time.h>
 #include <sys/ioctl.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/inotify.h>
 #include <fcntl.h>
 #ifdef _GNU_SOURCE
 #include <getopt.h>
@@ -85,12 +88,21 @@
 #include <regex.h>
 #include <wordexp.h>
 #include <execinfo.h>
+#ifdef HAVE_MALLINFO2
+#include <malloc.h>
+#endif
 
 #include <alpm.h>
 #include <glib.h>
+#include <glib-unix.h>
 
 #include <curl/curl.h>
 #include <json-c/json.h>
+#include <zlib.h>
+#ifdef HAVE_LIBARCHIVE
+#include <archive.h>
+#include <archive_entry.h>
+#endif
 
 /** @} */
 
@@ -100,9 +112,9 @@
 const char *
 _timestamp(void)
 {
-	static struct timeval tv = { 0, 0 };
-	static struct tm tm = { 0, };
-	static char buf[BUFSIZ];
+	static __thread struct timeval tv = { 0, 0 };
+	static __thread struct tm tm = { 0, };
+	static __thread char buf[BUFSIZ];
 	size_t len;
 
 	gettimeofday(&tv, NULL);
@@ -113,27 +125,148 @@ _timestamp(void)
 
 #define XPRINTF(_args...) do { } while (0)
 
-#define DPRINTF(_num, _args...) do { if (options.debug >= _num) { \
+#define DPRINTF(_num, _args...) do { if (options.debug >= _num) { REPORT_SYNC(); \
 		fprintf(stderr, NAME "[%d]: D: [%s] %12s: +%4d : %s() : ", getpid(), _timestamp(), __FILE__, __LINE__, __func__); \
 		fprintf(stderr, _args); fflush(stderr); } } while (0)
 
-#define EPRINTF(_args...) do { \
+#define EPRINTF(_args...) do { REPORT_SYNC(); \
 		fprintf(stderr, NAME "[%d]: E: [%s] %12s +%4d : %s() : ", getpid(), _timestamp(), __FILE__, __LINE__, __func__); \
 		fprintf(stderr, _args); fflush(stderr); } while (0)
 
+/* When set, report output of the calling thread is captured into this buffer
+   rather than written, so that it can be replayed later in order. */
+static __thread GString *report_capture = NULL;
+
+#define REPORT_BUFSIZE	(64 << 10)
+
+/* Report output is accumulated per stream and written when the buffer fills,
+   when output switches to the other stream, and at exit. */
+struct report_sink {
+	GString *buf;
+};
+
+static struct report_sink report_sinks[STDERR_FILENO + 1];
+static size_t report_threshold = REPORT_BUFSIZE;
+
+static void
+report_flush_sink(int fd)
+{
+	struct report_sink *sink = &report_sinks[fd];
+	FILE *stream = (fd == STDERR_FILENO) ? stderr : stdout;
+
+	if (!sink->buf || !sink->buf->len)
+		return;
+	fwrite(sink->buf->str, 1, sink->buf->len, stream);
+	fflush(stream);
+	g_string_truncate(sink->buf, 0);
+}
+
+/** @brief write out all buffered report output */
+static void
+report_flush(void)
+{
+	report_flush_sink(STDOUT_FILENO);
+	report_flush_sink(STDERR_FILENO);
+}
+
+/** @brief get the buffer into which to write report output for a stream */
+static GString *
+report_sink_get(int fd)
+{
+	struct report_sink *sink = &report_sinks[fd];
+
+	/* keep the order of lines written to stdout and stderr */
+	report_flush_sink(fd == STDERR_FILENO ? STDOUT_FILENO : STDERR_FILENO);
+	if (!sink->buf)
+		sink->buf = g_string_sized_new(REPORT_BUFSIZE);
+	return (sink->buf);
+}
+
+static void
+report_sink_done(int fd)
+{
+	struct report_sink *sink = &report_sinks[fd];
+
+	if (sink->buf->len >= report_threshold)
+		report_flush_sink(fd);
+}
+
+/* Diagnostics are written directly, so first write out report output that
+   precedes them.  Worker threads only ever capture report output. */
+#define REPORT_SYNC() do { if (!report_capture) report_flush(); } while (0)
+
+static void report_printf(FILE *stream, const char *prefix, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+static void
+report_printf(FILE *stream, const char *prefix, const char *fmt, ...)
+{
+	va_list args;
+	int fd = fileno(stream);
+
+	va_start(args, fmt);
+	if (report_capture) {
+		/* each record: stream number, text, terminating null */
+		g_string_append_c(report_capture, fd);
+		g_string_append(report_capture, prefix);
+		g_string_append_vprintf(report_capture, fmt, args);
+		g_string_append_c(report_capture, '\0');
+	} else {
+		GString *buf = report_sink_get(fd);
+
+		g_string_append(buf, prefix);
+		g_string_append_vprintf(buf, fmt, args);
+		report_sink_done(fd);
+	}
+	va_end(args);
+}
+
+/** @brief write out report output captured by another thread */
+static void
+report_replay(GString *capture)
+{
+	const char *p = capture->str, *e = capture->str + capture->len;
+
+	if (report_capture) {
+		/* the calling thread is capturing too */
+		g_string_append_len(report_capture, capture->str, capture->len);
+		return;
+	}
+	while (p < e) {
+		int fd = *p++;
+		size_t len = strlen(p);
+
+		g_string_append_len(report_sink_get(fd), p, len);
+		report_sink_done(fd);
+		p += len + 1;
+	}
+}
+
+/** @brief append the text of captured report output to a string */
+static void
+report_text(GString *capture, GString *text)
+{
+	const char *p = capture->str, *e = capture->str + capture->len;
+
+	while (p < e) {
+		size_t len = strlen(++p);
+
+		g_string_append_len(text, p, len);
+		p += len + 1;
+	}
+}
+
 #define WPRINTF(_args...) do { \
-		fprintf(stderr, "W: "); \
-		fprintf(stderr, _args); fflush(stderr); } while (0)
+		report_printf(stderr, "W: ", _args); } while (0)
 
+/* informational output goes to stderr when stdout carries structured records */
 #define IPRINTF(_args...) do { \
-		fprintf(stdout, "I: "); \
-		fprintf(stdout, _args); fflush(stdout); } while (0)
+		report_printf(options.format ? stderr : stdout, "I: ", _args); } while (0)
 
 #define OPRINTF(_num, _args...) do { if (options.debug >= _num || options.output > _num) { \
-		fprintf(stdout, "I: "); \
-		fprintf(stdout, _args); fflush(stdout); } } while (0)
+		report_printf(options.format ? stderr : stdout, "I: ", _args); } } while (0)
 
-#define PTRACE(_num) do { if (options.debug >= _num || options.output >= _num) { \
+#define PTRACE(_num) do { if (options.debug >= _num || options.output >= _num) { REPORT_SYNC(); \
 		fprintf(stderr, NAME "[%d]: T: [%s] %12s +%4d : %s()\n", getpid(), _timestamp(), __FILE__, __LINE__, __func__); \
 		fflush(stderr); } } while (0)
 
@@ -165,8 +298,21 @@ typedef enum {
 	CommandHelp,
 	CommandVersion,
 	CommandCopying,
+	CommandBenchmark,
+	CommandDaemon,
 } Command;
 
+typedef enum {
+	FormatText = 0,
+	FormatJsonl,
+	FormatTsv,
+} Format;
+
+typedef enum {
+	MethodPost = 0,
+	MethodGet,
+} Method;
+
 #define PACANA_ANALYSIS_SHADOW	    (1<<0)
 #define PACANA_ANALYSIS_PROVIDES    (1<<1)
 #define PACANA_ANALYSIS_ALTERNATE   (1<<2)
@@ -184,8 +330,20 @@ typedef enum {
 				    |PACANA_ANALYSIS_AURCHECK\
 				    |PACANA_ANALYSIS_MISSING)
 #define AUR_DEFAULT_URL		    "https://aur.archlinux.org/rpc/"
+#define AUR_DEFAULT_DUMP	    "https://aur.archlinux.org/packages-meta-ext-v1.json.gz"
 #define ARCH_STANDARD_REPOS	    "core,extra,community,multilib,ec2,testing,community-testing,multilib-testing"
 #define AUR_MAXLEN		    4443
+#define AUR_DEFAULT_TTL		    3600
+#define AUR_DEFAULT_PARALLEL	    4
+#define AUR_DEFAULT_BATCH	    250
+#define AUR_CONNECT_TIMEOUT	    30
+#define AUR_LOW_SPEED_TIME	    60
+#define AUR_BATCH_MAXAGE	    (7 * 24 * 3600)
+#define AUR_DEFAULT_RETRIES	    4
+#define AUR_BACKOFF_BASE	    500
+#define AUR_BACKOFF_MAX		    60000
+#define AUR_RATE_MIN		    0.1
+#define AUR_RATE_STEP		    0.25
 
 typedef struct {
 	int debug;
@@ -196,6 +354,25 @@ typedef struct {
 	char *repos;
 	char *custom;
 	int dryrun;
+	char *cachedir;
+	long ttl;
+	int parallel;
+	Method method;
+	int batch;
+	double rate;
+	int retries;
+	char *record;
+	char *replay;
+	char *dump;
+	int dumpall;
+	int jobs;
+	int unbuffered;
+	int timings;
+	Format format;
+	GSList *roots;			/* struct pacroot */
+	int native;
+	int incremental;
+	char *socket;
 } Options;
 
 Options options = {
@@ -207,1164 +384,6382 @@ Options options = {
 	.repos = NULL,
 	.custom = NULL,
 	.dryrun = 0,
+	.cachedir = NULL,
+	.ttl = AUR_DEFAULT_TTL,
+	.parallel = AUR_DEFAULT_PARALLEL,
+	.method = MethodPost,
+	.batch = AUR_DEFAULT_BATCH,
+	.rate = 0,
+	.retries = AUR_DEFAULT_RETRIES,
+	.record = NULL,
+	.replay = NULL,
+	.dump = NULL,
+	.dumpall = 0,
+	.jobs = 1,
+	.unbuffered = 0,
+	.timings = 0,
+	.format = FormatText,
+	.roots = NULL,
+	.native = 0,
+	.incremental = 0,
+	.socket = NULL,
+};
+
+/** @brief the time, in milliseconds, on a clock that only goes forward */
+static double
+pac_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0);
+}
+
+/* interned strings: each distinct string is stored once in an arena and
+   identified by a small, stable, non-zero integer */
+struct strtab {
+	char *arena;			/* current arena chunk */
+	size_t avail;			/* bytes remaining in arena chunk */
+	GSList *chunks;			/* all arena chunks */
+	const char **strs;		/* string for each id */
+	uint32_t *hashes;		/* hash of each string */
+	uint32_t count;			/* number of ids assigned (id 0 unused) */
+	uint32_t alloc;			/* allocated length of strs and hashes */
+	uint32_t *slots;		/* open addressed table of ids */
+	uint32_t mask;			/* size of slots less one */
+};
+
+/* open addressed map from interned string id to a value */
+struct nameslot {
+	uint32_t id;
+	void *val;
+};
+
+struct nameidx {
+	struct nameslot *slots;
+	uint32_t mask;			/* size of slots less one */
+	uint32_t count;
+};
+
+/* set of interned string ids */
+struct idset {
+	uint64_t *bits;
+	uint32_t words;
+};
+
+/* package record read directly from a sync database: only the fields that
+   the analyses use */
+struct pkgrec {
+	const char *name;
+	const char *version;
+	const char *base;
+	alpm_list_t *provides;		/* alpm_depend_t */
+	alpm_list_t *conflicts;		/* alpm_depend_t */
+	alpm_list_t *depends;		/* alpm_depend_t */
+};
+
+/* storage for the package records of a sync database */
+struct pkgstore {
+	GStringChunk *strings;		/* names and versions, each stored once */
+	GSList *chunks;			/* records, dependencies and list nodes */
+	char *next;			/* next free byte of current chunk */
+	size_t avail;			/* bytes remaining in current chunk */
+};
+
+/* a package with its name, for walking databases in name order */
+struct pkgname {
+	const char *name;
+	void *pkg;
+};
+
+/* a package as the checks see it: extracted once, in database order, so that
+   checking it for each analysis does not call the accessors again */
+struct pkgitem {
+	void *pkg;
+	const char *name;
+	const char *version;
+	alpm_list_t *provides;		/* alpm_depend_t */
+	alpm_list_t *conflicts;		/* alpm_depend_t */
+	alpm_list_t *depends;		/* alpm_depend_t */
+	gboolean vcs;			/* named as a VCS package */
 };
 
 struct dbhash {
 	alpm_db_t *db;
 	char *name;
-	alpm_list_t *pkgs;
-	GHashTable *hash;
+	alpm_list_t *pkgs;		/* alpm_pkg_t, or struct pkgrec when native */
+	struct pkgstore *store;		/* read natively when not NULL */
+	struct nameidx index;
+	struct idset provided;		/* names provided by the packages */
+	GHashTable *verkeys;		/* version -> struct verkey, when numeric */
+	struct pkgname *sorted;		/* packages in name order */
+	size_t nsorted;
+	struct pkgitem *items;		/* packages in database order */
+	size_t nitems;
+	int select;			/* 1 analyzed, 0 reference only */
+	gboolean indexed;
 	gboolean custom;
+	int refs;			/* roots sharing the database */
+};
+
+/* an installation root: sync databases with identical files are shared
+   between roots */
+struct pacroot {
+	char *root;			/* root directory */
+	char *dbpath;			/* database directory */
+	char *config;			/* pacman configuration file */
+	alpm_handle_t *handle;
+	GSList *slist;			/* struct dbhash, local database first */
+	struct idset provided;		/* names provided by any database */
+	struct json_object *snapprev;	/* previous run, when reusable */
+	struct json_object *snapnext;	/* this run */
+	struct json_object *snappkgs;	/* packages of this run, saved apart */
+	struct json_object *aurnames;	/* names looked up in the AUR */
+	struct idset changed;		/* names changed since previous run */
+	gboolean skipped;		/* unchanged since previous run, not loaded */
+	alpm_handle_t *lhandle;		/* of the local database, when reloaded */
 };
 
 /** @} */
 
-/** @section Analyze
+/** @section Name Index
   * @{ */
 
-int in_list(const char *list, const char *name)
+/*
+ * Package and provision names are interned once into a single string table and
+ * thereafter referred to by integer id.  Each database indexes its packages by
+ * name id in a compact open addressed table, and the set of provided names is
+ * a bit set over name ids.  This replaces a GHashTable per database plus a
+ * global GHashTable of provided names, each with its own strdup()'ed keys.
+ */
+
+#define STRTAB_CHUNK		(64 * 1024)
+
+struct strtab names = { NULL, };
+
+static inline uint32_t
+strtab_hash(const char *str, size_t *lenp)
 {
-	char *where;
-	int len;
+	const unsigned char *p = (const unsigned char *) str;
+	uint32_t h = 2166136261U;	/* FNV-1a */
 
-	if (!list || !list[0] || !name)
-		return (0);
-	len = strlen(name);
-	if ((where = strstr(list, name))) {
-		if ((where == list || where[-1] == ',' || where[-1] == '!') && (where[len] == '\0' || where[len] == ',')) {
-			if (where != list && where[-1] == '!')
-				return (-1);
-			return (1);
-		}
-	}
-	return (0);
+	for (; *p; p++)
+		h = (h ^ *p) * 16777619U;
+	*lenp = (const char *) p - str;
+	return (h);
 }
 
-static alpm_list_t *
-get_database_names(void)
+static void
+strtab_grow(struct strtab *tab)
 {
-	alpm_list_t *list = NULL;
-	char buf[81] = { 0, };
-	size_t l;
-	FILE *f;
+	uint32_t size = tab->mask ? (tab->mask + 1) << 1 : 1024;
+	uint32_t *slots = calloc(size, sizeof(*slots));
+	uint32_t id, i;
 
-	DPRINTF(1, "Opening /etc/pacman.conf\n");
-	if ((f = fopen("/etc/pacman.conf", "r"))) {
-		while (fgets(buf, 80, f)) {
-			if (!(l = strlen(buf)))
-				continue;
-			l--;
-			if (buf[l] == '\n') {
-				buf[l] = '\0';
-				l--;
-			}
-			if (!l)
-				continue;
-			DPRINTF(1, "Got line [%zd]: \"%s\"\n", l, buf);
-			if (buf[0] == '[' && buf[l] == ']') {
-				buf[l] = '\0';
-				if (strcmp(buf + 1, "options")) {
-					list = alpm_list_add(list, strdup(buf + 1));
-					DPRINTF(1, "Added ALPM database: %s\n", buf + 1);
-				}
-			}
-		}
-		fclose(f);
-	} else {
-		EPRINTF("Could not open /etc/pacman.conf: %s\n", strerror(errno));
+	for (id = 1; id <= tab->count; id++) {
+		for (i = tab->hashes[id] & (size - 1); slots[i]; i = (i + 1) & (size - 1)) ;
+		slots[i] = id;
 	}
-	return (list);
+	free(tab->slots);
+	tab->slots = slots;
+	tab->mask = size - 1;
 }
 
-static void
-destroy_dbhash(gpointer data)
+static uint32_t
+strtab_probe(struct strtab *tab, const char *str, uint32_t hash, uint32_t *slotp)
 {
-	struct dbhash *dbhash = data;
+	uint32_t i, id;
 
-	if (dbhash->hash)
-		g_hash_table_destroy(dbhash->hash);
-	free(dbhash->name);
-	dbhash->name = NULL;
-	dbhash->pkgs = NULL;
-	dbhash->hash = NULL;
-	free(dbhash);
+	for (i = hash & tab->mask; (id = tab->slots[i]); i = (i + 1) & tab->mask)
+		if (tab->hashes[id] == hash && !strcmp(tab->strs[id], str))
+			break;
+	*slotp = i;
+	return (id);
 }
 
-typedef struct aur_pkg {
-	char *base;			/* like alpm_pkg_get_base */
-	char *name;			/* like alpm_pkg_get_name */
-	char *version;			/* like alpm_pkg_get_version */
-	char *desc;			/* like alpm_pkg_get_desc */
-	char *url;			/* like alpm_pkg_get_url */
-	alpm_list_t *licenses;		/* like alpm_pkg_get_licenses */
-	alpm_list_t *groups;		/* like alpm_pkg_get_groups */
-	alpm_list_t *depends;		/* like alpm_pkg_get_depends */
-	alpm_list_t *optdepends;	/* like alpm_pkg_get_optdepends */
-	alpm_list_t *checkdepends;	/* like alpm_pkg_get_checkdepends */
-	alpm_list_t *makedepends;	/* like alpm_pkg_get_makedepends */
-	alpm_list_t *conflicts;		/* like alpm_pkg_get_conflicts */
-	alpm_list_t *provides;		/* like alpm_pkg_get_provides */
-	alpm_list_t *replaces;		/* like alpm_pkg_get_replaces */
-	char *maintainer;
-#if 0
-	int id;
-	int baseid;
-	int numvotes;
-	double popularity;
-	char *maintainer;
-	time_t first_submitted;
-	time_t last_modified;
-	char *urlpath;
-	alpm_list_t *keywords;
-#endif
-} aur_pkg_t;
+/** @brief look up a string without interning it
+  * @return the id of the string or zero when the string was never interned
+  */
+uint32_t
+strtab_find(struct strtab *tab, const char *str)
+{
+	uint32_t hash, slot;
+	size_t len;
 
-const char *
-aur_pkg_get_base(aur_pkg_t *pkg)
+	if (!tab->slots || !str)
+		return (0);
+	hash = strtab_hash(str, &len);
+	return (strtab_probe(tab, str, hash, &slot));
+}
+
+/** @brief intern a string
+  * @return the id of the string
+  */
+uint32_t
+strtab_intern(struct strtab *tab, const char *str)
 {
-	return (pkg->base);
+	uint32_t hash, slot, id;
+	size_t len;
+	char *copy;
+
+	if (!tab->slots || (tab->count + 1) * 2 > tab->mask)
+		strtab_grow(tab);
+	hash = strtab_hash(str, &len);
+	if ((id = strtab_probe(tab, str, hash, &slot)))
+		return (id);
+	if (len + 1 > tab->avail) {
+		size_t size = MAX(STRTAB_CHUNK, len + 1);
+
+		tab->arena = malloc(size);
+		tab->avail = size;
+		tab->chunks = g_slist_prepend(tab->chunks, tab->arena);
+	}
+	copy = memcpy(tab->arena, str, len + 1);
+	tab->arena += len + 1;
+	tab->avail -= len + 1;
+	if (tab->count + 1 >= tab->alloc) {
+		tab->alloc = tab->alloc ? tab->alloc << 1 : 1024;
+		tab->strs = realloc(tab->strs, tab->alloc * sizeof(*tab->strs));
+		tab->hashes = realloc(tab->hashes, tab->alloc * sizeof(*tab->hashes));
+	}
+	id = ++tab->count;
+	tab->strs[id] = copy;
+	tab->hashes[id] = hash;
+	tab->slots[slot] = id;
+	return (id);
 }
 
-const char *
-aur_pkg_get_name(aur_pkg_t *pkg)
+static inline const char *
+strtab_str(struct strtab *tab, uint32_t id)
 {
-	return (pkg->name);
+	return (id && id <= tab->count ? tab->strs[id] : NULL);
 }
 
-const char *
-aur_pkg_get_version(aur_pkg_t *pkg)
+void
+strtab_clear(struct strtab *tab)
 {
-	return (pkg->version);
+	g_slist_free_full(tab->chunks, free);
+	free(tab->strs);
+	free(tab->hashes);
+	free(tab->slots);
+	memset(tab, 0, sizeof(*tab));
 }
 
-const char *
-aur_pkg_get_desc(aur_pkg_t *pkg)
+static inline uint32_t
+nameidx_slot(uint32_t id, uint32_t mask)
 {
-	return (pkg->desc);
+	return ((id * 2654435761U) & mask);
 }
 
-const char *
-aur_pkg_get_url(aur_pkg_t *pkg)
+static void
+nameidx_grow(struct nameidx *idx)
 {
-	return (pkg->url);
+	uint32_t size = idx->mask ? (idx->mask + 1) << 1 : 64;
+	struct nameslot *slots = calloc(size, sizeof(*slots));
+	uint32_t n, i;
+
+	for (n = 0; idx->slots && n <= idx->mask; n++) {
+		if (!idx->slots[n].id)
+			continue;
+		for (i = nameidx_slot(idx->slots[n].id, size - 1); slots[i].id; i = (i + 1) & (size - 1)) ;
+		slots[i] = idx->slots[n];
+	}
+	free(idx->slots);
+	idx->slots = slots;
+	idx->mask = size - 1;
 }
 
-alpm_list_t *
-aur_pkg_get_licenses(aur_pkg_t *pkg)
+void
+nameidx_insert(struct nameidx *idx, uint32_t id, void *val)
 {
-	return (pkg->licenses);
+	uint32_t i;
+
+	if (!idx->slots || (idx->count + 1) * 4 > (idx->mask + 1) * 3)
+		nameidx_grow(idx);
+	for (i = nameidx_slot(id, idx->mask); idx->slots[i].id; i = (i + 1) & idx->mask) {
+		if (idx->slots[i].id == id) {
+			idx->slots[i].val = val;
+			return;
+		}
+	}
+	idx->slots[i].id = id;
+	idx->slots[i].val = val;
+	idx->count++;
 }
 
+void *
+nameidx_lookup(const struct nameidx *idx, uint32_t id)
+{
+	uint32_t i;
+
+	if (!idx->slots || !id)
+		return (NULL);
+	for (i = nameidx_slot(id, idx->mask); idx->slots[i].id; i = (i + 1) & idx->mask)
+		if (idx->slots[i].id == id)
+			return (idx->slots[i].val);
+	return (NULL);
+}
 
-alpm_list_t *
-aur_pkg_get_groups(aur_pkg_t *pkg)
+void
+nameidx_clear(struct nameidx *idx)
 {
-	return (pkg->groups);
+	free(idx->slots);
+	memset(idx, 0, sizeof(*idx));
 }
 
+void
+idset_add(struct idset *set, uint32_t id)
+{
+	uint32_t word = id >> 6;
 
-alpm_list_t *
-aur_pkg_get_depends(aur_pkg_t *pkg)
+	if (word >= set->words) {
+		uint32_t words = MAX(word + 1, set->words << 1);
+
+		set->bits = realloc(set->bits, words * sizeof(*set->bits));
+		memset(set->bits + set->words, 0, (words - set->words) * sizeof(*set->bits));
+		set->words = words;
+	}
+	set->bits[word] |= (uint64_t) 1 << (id & 63);
+}
+
+static inline gboolean
+idset_contains(const struct idset *set, uint32_t id)
 {
-	return (pkg->depends);
+	uint32_t word = id >> 6;
+
+	return (id && word < set->words && (set->bits[word] & ((uint64_t) 1 << (id & 63))));
 }
 
+/** @brief add the ids of one set to another */
+void
+idset_union(struct idset *set, const struct idset *other)
+{
+	uint32_t word;
 
-alpm_list_t *
-aur_pkg_get_optdepends(aur_pkg_t *pkg)
+	if (other->words > set->words) {
+		set->bits = realloc(set->bits, other->words * sizeof(*set->bits));
+		memset(set->bits + set->words, 0, (other->words - set->words) * sizeof(*set->bits));
+		set->words = other->words;
+	}
+	for (word = 0; word < other->words; word++)
+		set->bits[word] |= other->bits[word];
+}
+
+void
+idset_clear(struct idset *set)
 {
-	return (pkg->optdepends);
+	free(set->bits);
+	memset(set, 0, sizeof(*set));
 }
 
+/** @brief add a package to the name index of a database */
+static inline void
+dbhash_insert(struct dbhash *dbhash, const char *name, void *pkg)
+{
+	nameidx_insert(&dbhash->index, strtab_intern(&names, name), pkg);
+}
 
-alpm_list_t *
-aur_pkg_get_checkdepends(aur_pkg_t *pkg)
+/** @brief look up a package by name in a database */
+static inline void *
+dbhash_lookup(const struct dbhash *dbhash, const char *name)
 {
-	return (pkg->checkdepends);
+	return (nameidx_lookup(&dbhash->index, strtab_find(&names, name)));
 }
 
+/** @brief order packages by name */
+static int
+pkgname_cmp(const void *a, const void *b)
+{
+	return (strcmp(((const struct pkgname *) a)->name, ((const struct pkgname *) b)->name));
+}
 
-alpm_list_t *
-aur_pkg_get_makedepends(aur_pkg_t *pkg)
+/* Accessors for a package of a database, which is an alpm_pkg_t unless the
+   database was read natively. */
+
+static inline const char *
+dbhash_pkg_get_name(const struct dbhash *dbhash, void *pkg)
 {
-	return (pkg->makedepends);
+	return (dbhash->store ? ((struct pkgrec *) pkg)->name : alpm_pkg_get_name(pkg));
 }
 
+static inline const char *
+dbhash_pkg_get_version(const struct dbhash *dbhash, void *pkg)
+{
+	return (dbhash->store ? ((struct pkgrec *) pkg)->version : alpm_pkg_get_version(pkg));
+}
 
-alpm_list_t *
-aur_pkg_get_conflicts(aur_pkg_t *pkg)
+static inline alpm_list_t *
+dbhash_pkg_get_provides(const struct dbhash *dbhash, void *pkg)
 {
-	return (pkg->conflicts);
+	return (dbhash->store ? ((struct pkgrec *) pkg)->provides : alpm_pkg_get_provides(pkg));
 }
 
+static inline alpm_list_t *
+dbhash_pkg_get_conflicts(const struct dbhash *dbhash, void *pkg)
+{
+	return (dbhash->store ? ((struct pkgrec *) pkg)->conflicts : alpm_pkg_get_conflicts(pkg));
+}
 
-alpm_list_t *
-aur_pkg_get_provides(aur_pkg_t *pkg)
+static inline alpm_list_t *
+dbhash_pkg_get_depends(const struct dbhash *dbhash, void *pkg)
 {
-	return (pkg->provides);
+	return (dbhash->store ? ((struct pkgrec *) pkg)->depends : alpm_pkg_get_depends(pkg));
 }
 
+/** @} */
 
-alpm_list_t *
-aur_pkg_get_replaces(aur_pkg_t *pkg)
+/** @section Version Keys
+  * @{ */
+
+/*
+ * Versions are compared as alpm_pkg_vercmp() compares them, but most versions
+ * are purely numeric: [EPOCH:]N[.N]...[-N[.N]...].  Such a version is parsed
+ * once, when its database is indexed, into a key of numeric segments that
+ * compares without looking at the string again.  Numeric segments compare as
+ * numbers, and when one version has more segments than the other and they
+ * agree up to that point, the longer one is newer.  The release is only
+ * compared when both versions have one.  All other versions are compared with
+ * alpm_pkg_vercmp(), remembering recent results per thread.
+ */
+
+#define VERKEY_PARTS	8		/* segments of pkgver and pkgrel */
+#define VERKEY_DIGITS	9		/* digits of a segment */
+
+struct verkey {
+	uint32_t part[VERKEY_PARTS];	/* segments of pkgver, then of pkgrel */
+	uint32_t epoch;
+	uint8_t nver;			/* segments of pkgver */
+	uint8_t nrel;			/* segments of pkgrel, 0 when none */
+};
+
+/** @brief parse the numeric segments of a version between @b and @e
+  * @return FALSE when not purely numeric or too many or long segments
+  */
+static gboolean
+verkey_parts(struct verkey *key, const char *b, const char *e, uint8_t *count)
 {
-	return (pkg->replaces);
+	const char *p = b;
+
+	for (;;) {
+		uint32_t n = 0;
+		const char *d = p;
+
+		for (; p < e && isdigit(*p); p++)
+			n = n * 10 + (*p - '0');
+		if (p == d || p - d > VERKEY_DIGITS || key->nver + key->nrel + *count >= VERKEY_PARTS)
+			return (FALSE);
+		key->part[key->nver + key->nrel + *count] = n;
+		(*count)++;
+		if (p == e)
+			return (TRUE);
+		/* a single period separates segments */
+		if (*p++ != '.' || p == e)
+			return (FALSE);
+	}
 }
 
-struct dbhash *aur_db = NULL;
-GHashTable *provided = NULL;
+/** @brief parse a version into a key
+  * @return FALSE when the version is not purely numeric
+  */
+static gboolean
+verkey_parse(const char *version, struct verkey *key)
+{
+	const char *p = version, *q, *rel;
+	uint8_t count = 0;
+
+	memset(key, 0, sizeof(*key));
+	for (q = p; isdigit(*q); q++) ;
+	if (*q == ':') {
+		if (q - p > VERKEY_DIGITS)
+			return (FALSE);
+		for (; p < q; p++)
+			key->epoch = key->epoch * 10 + (*p - '0');
+		p = q + 1;
+	}
+	if (!(rel = strrchr(p, '-')))
+		rel = p + strlen(p);
+	if (!verkey_parts(key, p, rel, &count))
+		return (FALSE);
+	key->nver = count;
+	if (*rel) {
+		count = 0;
+		if (!verkey_parts(key, rel + 1, rel + strlen(rel), &count))
+			return (FALSE);
+		key->nrel = count;
+	}
+	return (TRUE);
+}
 
-void
-check_shadow(GSList *s, alpm_pkg_t *pkg)
+static inline int
+verkey_cmp_parts(const uint32_t *a, unsigned na, const uint32_t *b, unsigned nb)
 {
-	struct dbhash *dbhash = s->data;
+	unsigned i;
+
+	for (i = 0; i < na && i < nb; i++)
+		if (a[i] != b[i])
+			return (a[i] < b[i] ? -1 : 1);
+	return (na == nb ? 0 : (na < nb ? -1 : 1));
+}
+
+/** @brief compare two version keys as alpm_pkg_vercmp() compares versions */
+static inline int
+verkey_cmp(const struct verkey *a, const struct verkey *b)
+{
+	int ret;
+
+	if (a->epoch != b->epoch)
+		return (a->epoch < b->epoch ? -1 : 1);
+	if ((ret = verkey_cmp_parts(a->part, a->nver, b->part, b->nver)))
+		return (ret);
+	if (a->nrel && b->nrel)
+		return (verkey_cmp_parts(a->part + a->nver, a->nrel, b->part + b->nver, b->nrel));
+	return (0);
+}
+
+/** @brief key the version of a package of a database, when numeric */
+static void
+dbhash_verkey_add(struct dbhash *dbhash, const char *version)
+{
+	struct verkey key, *copy;
+
+	if (!version || !verkey_parse(version, &key))
+		return;
+	if (!dbhash->verkeys)
+		dbhash->verkeys = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+	copy = g_new(struct verkey, 1);
+	*copy = key;
+	/* keyed by address: the strings live as long as the database */
+	g_hash_table_insert(dbhash->verkeys, (gpointer) version, copy);
+}
+
+static inline const struct verkey *
+dbhash_verkey(const struct dbhash *dbhash, const char *version)
+{
+	return (dbhash->verkeys ? g_hash_table_lookup(dbhash->verkeys, version) : NULL);
+}
+
+#define VERCMP_MEMO	4096		/* remembered results, a power of two */
+
+struct vercmp_memo {
+	const char *a, *b;
+	unsigned generation;
+	int ret;
+};
+
+/* Remembered results are keyed by the addresses of the strings, so are
+   forgotten whenever a database, and with it its strings, is freed. */
+static volatile unsigned vercmp_generation = 1;
+static __thread struct vercmp_memo *vercmp_memo = NULL;
+
+static int
+vercmp_memoized(const char *a, const char *b)
+{
+	struct vercmp_memo *m;
+	uintptr_t h;
+
+	if (!vercmp_memo)
+		vercmp_memo = calloc(VERCMP_MEMO, sizeof(*vercmp_memo));
+	h = ((uintptr_t) a >> 3) * 31 + ((uintptr_t) b >> 3);
+	m = &vercmp_memo[(h ^ (h >> 12)) & (VERCMP_MEMO - 1)];
+	if (m->a != a || m->b != b || m->generation != vercmp_generation) {
+		m->a = a;
+		m->b = b;
+		m->generation = vercmp_generation;
+		m->ret = alpm_pkg_vercmp(a, b);
+	}
+	return (m->ret);
+}
+
+static void
+vercmp_memo_free(void)
+{
+	free(vercmp_memo);
+	vercmp_memo = NULL;
+}
+
+/** @brief compare a version of a database with one of another database
+  * @return -1, 0 or 1 as alpm_pkg_vercmp()
+  */
+static int
+pac_vercmp(const struct dbhash *dbhash, const char *a, const struct dbhash *dbhash2, const char *b)
+{
+	const struct verkey *ka, *kb;
+
+	if ((ka = dbhash_verkey(dbhash, a)) && (kb = dbhash_verkey(dbhash2, b)))
+		return (verkey_cmp(ka, kb));
+	return (vercmp_memoized(a, b));
+}
+
+/** @} */
+
+/** @section Findings
+  * @{ */
+
+typedef enum {
+	FindingMasks,
+	FindingOutOfDate,
+	FindingCouldBeOutOfDate,
+	FindingProvides,
+	FindingProvidesVersion,
+	FindingUpToDate,
+	FindingAppearsUpToDate,
+	FindingVcsPackage,
+	FindingDivorced,
+	FindingOrphan,
+	FindingForeign,
+	FindingBuiltFrom,
+	FindingStranded,
+	FindingNeeds,
+	FindingMissing,
+	FindingAlternate,
+	FindingAlternateVersion,
+	FindingFlagged,
+} FindingKind;
+
+typedef enum {
+	ActionNone = 0,
+	ActionAddProvidesVersion,
+	ActionRebuild,
+	ActionAdopt,
+	ActionBuild,
+	ActionCreate,
+	ActionFind,
+} FindingAction;
+
+/* A finding about a package (repo/name version), possibly with respect to a
+   related package (repo2/name2 version2) or a dependency.  Warnings have
+   level 0; other findings are shown at the given output verbosity.  The
+   suggested action applies to the related package when action_related is
+   set, and to the package otherwise. */
+struct finding {
+	FindingKind kind;
+	int level;
+	const char *repo, *name, *version;
+	const char *repo2, *name2, *version2;
+	const char *depend;
+	FindingAction action;
+	gboolean action_related;
+};
+
+/* root of the findings reported, when analyzing more than one root */
+static const char *finding_root = NULL;
+
+static const struct {
+	const char *kind;		/* record kind */
+	const char *text;		/* text following "repo/name version" */
+} finding_kinds[] = {
+	/* *INDENT-OFF* */
+	[FindingMasks]		  = { "masks",		      " masks %R"			},
+	[FindingOutOfDate]	  = { "out-of-date",	      " out of date"			},
+	[FindingCouldBeOutOfDate] = { "could-be-out-of-date", " could be out of date"		},
+	[FindingProvides]	  = { "provides",	      " provides %R"			},
+	[FindingProvidesVersion]  = { "provides-version",     " provides %N %V"			},
+	[FindingUpToDate]	  = { "up-to-date",	      " up to date"			},
+	[FindingAppearsUpToDate]  = { "appears-up-to-date",   " appears up to date"		},
+	[FindingVcsPackage]	  = { "vcs-package",	      " vcs package for %R"		},
+	[FindingDivorced]	  = { "divorced",	      " divorced to %R"			},
+	[FindingOrphan]		  = { "orphan",		      " is an orphan"			},
+	[FindingForeign]	  = { "foreign",	      " foreign"			},
+	[FindingBuiltFrom]	  = { "built-from",	      " built from %R"			},
+	[FindingStranded]	  = { "stranded",	      " stranded"			},
+	[FindingNeeds]		  = { "needs",		      " dependency %D needs: %R"	},
+	[FindingMissing]	  = { "missing",	      " dependency missing: %D"		},
+	[FindingAlternate]	  = { "alternate",	      " alternate for %D to %R"		},
+	[FindingAlternateVersion] = { "alternate-version",    " provides %D older than %R"	},
+	[FindingFlagged]	  = { "flagged",	      " flagged out of date"		},
+	/* *INDENT-ON* */
+};
+
+static const struct {
+	const char *action;		/* record action */
+	const char *text;		/* text following "repo/name version => " */
+} finding_actions[] = {
+	/* *INDENT-OFF* */
+	[ActionNone]		   = { "",			NULL					},
+	[ActionAddProvidesVersion] = { "add-provides-version",	"add provides=() version to PKGBUILD"	},
+	[ActionRebuild]		   = { "rebuild",		"rebuild from %R"			},
+	[ActionAdopt]		   = { "adopt",			"adopt package"				},
+	[ActionBuild]		   = { "build",			"build %D from %R"			},
+	[ActionCreate]		   = { "create",		"create package for %D"			},
+	[ActionFind]		   = { "find",			"find package for %D"			},
+	/* *INDENT-ON* */
+};
+
+/** @brief expand a finding text: %D dependency, %N related name, %V related
+  * version, %R related "repo/name version" */
+static void
+finding_expand(GString *out, const char *text, const struct finding *f)
+{
+	const char *p;
+
+	for (p = text; *p; p++) {
+		if (*p != '%' || !p[1]) {
+			g_string_append_c(out, *p);
+			continue;
+		}
+		switch (*++p) {
+		case 'D':
+			g_string_append(out, f->depend);
+			break;
+		case 'N':
+			g_string_append(out, f->name2);
+			break;
+		case 'V':
+			g_string_append(out, f->version2);
+			break;
+		case 'R':
+			g_string_append_printf(out, "%s/%s %s", f->repo2, f->name2, f->version2);
+			break;
+		default:
+			g_string_append_c(out, *p);
+			break;
+		}
+	}
+}
+
+static void
+finding_json_string(GString *out, const char *key, const char *val)
+{
+	const char *p;
+
+	if (!val)
+		return;
+	g_string_append_printf(out, ",\"%s\":\"", key);
+	for (p = val; *p; p++) {
+		switch (*p) {
+		case '"':
+		case '\\':
+			g_string_append_c(out, '\\');
+			g_string_append_c(out, *p);
+			break;
+		default:
+			if ((unsigned char) *p < 0x20)
+				g_string_append_printf(out, "\\u%04x", *p);
+			else
+				g_string_append_c(out, *p);
+			break;
+		}
+	}
+	g_string_append_c(out, '"');
+}
+
+static void
+finding_tsv_string(GString *out, const char *val)
+{
+	const char *p;
+
+	g_string_append_c(out, '\t');
+	for (p = val ? : ""; *p; p++)
+		g_string_append_c(out, (*p == '\t' || *p == '\n') ? ' ' : *p);
+}
+
+/** @brief report a finding in the selected output format
+  *
+  * Text output is the traditional "W: " or "I: " line, followed at output
+  * verbosity 3 by a line suggesting an action.  Structured output writes
+  * one record per finding to standard output, as a JSON object per line
+  * (jsonl) or tab-separated fields (tsv): kind, level, repo, name, version,
+  * repo2, name2, version2, depend, action, root.
+  */
+static void
+report_finding(const struct finding *f)
+{
+	const char *level = f->level ? "info" : "warning";
+	GString *out;
+
+	if (f->level && !(options.debug >= f->level || options.output > f->level))
+		return;
+	switch (options.format) {
+	case FormatText:
+		out = g_string_new(NULL);
+		if (finding_root)
+			g_string_append_printf(out, "%s: ", finding_root);
+		g_string_append_printf(out, "%s/%s %s", f->repo, f->name, f->version);
+		finding_expand(out, finding_kinds[f->kind].text, f);
+		if (f->level)
+			OPRINTF(f->level, "%s\n", out->str);
+		else
+			WPRINTF("%s\n", out->str);
+		if (f->action && (options.debug >= 3 || options.output > 3)) {
+			g_string_truncate(out, 0);
+			if (finding_root)
+				g_string_append_printf(out, "%s: ", finding_root);
+			if (f->action_related)
+				g_string_append_printf(out, "%s/%s %s => ", f->repo2, f->name2, f->version2);
+			else
+				g_string_append_printf(out, "%s/%s %s => ", f->repo, f->name, f->version);
+			finding_expand(out, finding_actions[f->action].text, f);
+			OPRINTF(3, "%s\n", out->str);
+		}
+		g_string_free(out, TRUE);
+		break;
+	case FormatJsonl:
+		out = g_string_new(NULL);
+		g_string_printf(out, "{\"kind\":\"%s\",\"level\":\"%s\"", finding_kinds[f->kind].kind, level);
+		finding_json_string(out, "repo", f->repo);
+		finding_json_string(out, "name", f->name);
+		finding_json_string(out, "version", f->version);
+		finding_json_string(out, "repo2", f->repo2);
+		finding_json_string(out, "name2", f->name2);
+		finding_json_string(out, "version2", f->version2);
+		finding_json_string(out, "depend", f->depend);
+		if (f->action)
+			finding_json_string(out, "action", finding_actions[f->action].action);
+		finding_json_string(out, "root", finding_root);
+		g_string_append(out, "}\n");
+		report_printf(stdout, "", "%s", out->str);
+		g_string_free(out, TRUE);
+		break;
+	case FormatTsv:
+		out = g_string_new(finding_kinds[f->kind].kind);
+		finding_tsv_string(out, level);
+		finding_tsv_string(out, f->repo);
+		finding_tsv_string(out, f->name);
+		finding_tsv_string(out, f->version);
+		finding_tsv_string(out, f->repo2);
+		finding_tsv_string(out, f->name2);
+		finding_tsv_string(out, f->version2);
+		finding_tsv_string(out, f->depend);
+		finding_tsv_string(out, finding_actions[f->action].action);
+		finding_tsv_string(out, finding_root);
+		g_string_append_c(out, '\n');
+		report_printf(stdout, "", "%s", out->str);
+		g_string_free(out, TRUE);
+		break;
+	}
+}
+
+#define FINDING(_kind, _level, _args...) do { \
+		struct finding _f = { .kind = _kind, .level = _level, _args }; \
+		report_finding(&_f); } while (0)
+
+/** @} */
+
+/** @section Analyze
+  * @{ */
+
+int in_list(const char *list, const char *name)
+{
+	char *where;
+	int len;
+
+	if (!list || !list[0] || !name)
+		return (0);
+	len = strlen(name);
+	if ((where = strstr(list, name))) {
+		if ((where == list || where[-1] == ',' || where[-1] == '!') && (where[len] == '\0' || where[len] == ',')) {
+			if (where != list && where[-1] == '!')
+				return (-1);
+			return (1);
+		}
+	}
+	return (0);
+}
+
+/** @brief how --repos selects a repository
+  * @return 1 when analyzed, 0 when only referenced by the analysis of other
+  * repositories, -1 when excluded altogether
+  *
+  * Repositories that are not listed are analyzed, unless the list names a
+  * repository without a ! prefix.
+  */
+static int
+repo_select(const char *name)
+{
+	const char *p;
+	int select;
+
+	if (!options.repos || (select = in_list(options.repos, name)))
+		return (options.repos ? select : 1);
+	for (p = options.repos; p; p = strchr(p, ',')) {
+		if (*p == ',')
+			p++;
+		if (*p && *p != '!' && *p != ',')
+			return (0);
+	}
+	return (1);
+}
+
+static alpm_list_t *
+get_database_names(const char *config)
+{
+	alpm_list_t *list = NULL;
+	char buf[81] = { 0, };
+	size_t l;
+	FILE *f;
+
+	DPRINTF(1, "Opening %s\n", config);
+	if ((f = fopen(config, "r"))) {
+		while (fgets(buf, 80, f)) {
+			if (!(l = strlen(buf)))
+				continue;
+			l--;
+			if (buf[l] == '\n') {
+				buf[l] = '\0';
+				l--;
+			}
+			if (!l)
+				continue;
+			DPRINTF(1, "Got line [%zd]: \"%s\"\n", l, buf);
+			if (buf[0] == '[' && buf[l] == ']') {
+				buf[l] = '\0';
+				if (strcmp(buf + 1, "options")) {
+					list = alpm_list_add(list, strdup(buf + 1));
+					DPRINTF(1, "Added ALPM database: %s\n", buf + 1);
+				}
+			}
+		}
+		fclose(f);
+	} else {
+		EPRINTF("Could not open %s: %s\n", config, strerror(errno));
+	}
+	return (list);
+}
+
+static void pkgstore_free(struct pkgstore *store);
+
+static void
+destroy_dbhash(gpointer data)
+{
+	struct dbhash *dbhash = data;
+
+	if (--dbhash->refs > 0)
+		return;
+	nameidx_clear(&dbhash->index);
+	idset_clear(&dbhash->provided);
+	if (dbhash->verkeys)
+		g_hash_table_destroy(dbhash->verkeys);
+	free(dbhash->sorted);
+	free(dbhash->items);
+	/* remembered comparisons may refer to its strings */
+	vercmp_generation++;
+	pkgstore_free(dbhash->store);
+	free(dbhash->name);
+	dbhash->name = NULL;
+	dbhash->pkgs = NULL;
+	free(dbhash);
+}
+
+typedef struct aur_pkg {
+	char *base;			/* like alpm_pkg_get_base */
+	char *name;			/* like alpm_pkg_get_name */
+	char *version;			/* like alpm_pkg_get_version */
+	char *desc;			/* like alpm_pkg_get_desc */
+	char *url;			/* like alpm_pkg_get_url */
+	alpm_list_t *licenses;		/* like alpm_pkg_get_licenses */
+	alpm_list_t *groups;		/* like alpm_pkg_get_groups */
+	alpm_list_t *depends;		/* like alpm_pkg_get_depends */
+	alpm_list_t *optdepends;	/* like alpm_pkg_get_optdepends */
+	alpm_list_t *checkdepends;	/* like alpm_pkg_get_checkdepends */
+	alpm_list_t *makedepends;	/* like alpm_pkg_get_makedepends */
+	alpm_list_t *conflicts;		/* like alpm_pkg_get_conflicts */
+	alpm_list_t *provides;		/* like alpm_pkg_get_provides */
+	alpm_list_t *replaces;		/* like alpm_pkg_get_replaces */
+	char *maintainer;
+	time_t outofdate;		/* when flagged out of date, or 0 */
+#if 0
+	int id;
+	int baseid;
+	int numvotes;
+	double popularity;
+	char *maintainer;
+	time_t first_submitted;
+	time_t last_modified;
+	char *urlpath;
+	alpm_list_t *keywords;
+#endif
+} aur_pkg_t;
+
+const char *
+aur_pkg_get_base(aur_pkg_t *pkg)
+{
+	return (pkg->base);
+}
+
+const char *
+aur_pkg_get_name(aur_pkg_t *pkg)
+{
+	return (pkg->name);
+}
+
+const char *
+aur_pkg_get_version(aur_pkg_t *pkg)
+{
+	return (pkg->version);
+}
+
+const char *
+aur_pkg_get_desc(aur_pkg_t *pkg)
+{
+	return (pkg->desc);
+}
+
+const char *
+aur_pkg_get_url(aur_pkg_t *pkg)
+{
+	return (pkg->url);
+}
+
+alpm_list_t *
+aur_pkg_get_licenses(aur_pkg_t *pkg)
+{
+	return (pkg->licenses);
+}
+
+
+alpm_list_t *
+aur_pkg_get_groups(aur_pkg_t *pkg)
+{
+	return (pkg->groups);
+}
+
+
+alpm_list_t *
+aur_pkg_get_depends(aur_pkg_t *pkg)
+{
+	return (pkg->depends);
+}
+
+
+alpm_list_t *
+aur_pkg_get_optdepends(aur_pkg_t *pkg)
+{
+	return (pkg->optdepends);
+}
+
+
+alpm_list_t *
+aur_pkg_get_checkdepends(aur_pkg_t *pkg)
+{
+	return (pkg->checkdepends);
+}
+
+
+alpm_list_t *
+aur_pkg_get_makedepends(aur_pkg_t *pkg)
+{
+	return (pkg->makedepends);
+}
+
+
+alpm_list_t *
+aur_pkg_get_conflicts(aur_pkg_t *pkg)
+{
+	return (pkg->conflicts);
+}
+
+
+alpm_list_t *
+aur_pkg_get_provides(aur_pkg_t *pkg)
+{
+	return (pkg->provides);
+}
+
+
+alpm_list_t *
+aur_pkg_get_replaces(aur_pkg_t *pkg)
+{
+	return (pkg->replaces);
+}
+
+#define FREELIST(_list) do { alpm_list_free_inner(_list, free); alpm_list_free(_list); } while (0)
+#define FREEDEPS(_list) do { alpm_list_free_inner(_list, (void (*)(void *)) alpm_dep_free); alpm_list_free(_list); } while (0)
+
+struct dbhash *aur_db = NULL;
+GHashTable *aur_failed = NULL;		/* names the AUR could not be asked about */
+double aur_deadline = 0;		/* pac_now() by which AUR requests end, or 0 */
+struct idset *provided = NULL;		/* of the root being analyzed */
+
+struct dbhash *aur_db_get(void);
+struct json_object *aur_cache_validators(const char *key, GSList *names);
+void aur_cache_validated(const char *key, const char *etag, const char *modified);
+int aur_cache_revalidate(const char *key, GSList *names);
+
+/** @brief whether AUR information is available to the analyses */
+static inline gboolean
+aur_enabled(void)
+{
+	return (options.url || options.dump);
+}
+
+/** @brief whether the AUR was asked about a name, so that its absence from
+  * the AUR means something
+  */
+static inline gboolean
+aur_known(const char *name)
+{
+	return (!aur_failed || !g_hash_table_contains(aur_failed, name));
+}
+
+void
+check_shadow(GSList *s, const struct pkgitem *item)
+{
+	struct dbhash *dbhash = s->data;
+	const char *sync = dbhash->name;
+	const char *name = item->name;
+	const char *vers = item->version;
+	for (GSList *n = s->next; n; n = n->next) {
+		struct dbhash *dbhash2 = n->data;
+		const char *sync2 = dbhash2->name;
+		if (strstr(sync2, "testing"))
+			continue;
+		void *pkg2;
+		if ((pkg2 = dbhash_lookup(dbhash2, name))) {
+			const char *name2 = dbhash_pkg_get_name(dbhash2, pkg2);
+			const char *vers2 = dbhash_pkg_get_version(dbhash2, pkg2);
+
+			FINDING(FindingMasks, 0, sync, name, vers, sync2, name2, vers2);
+			switch (pac_vercmp(dbhash, vers, dbhash2, vers2)) {
+			case -1:
+				FINDING(FindingOutOfDate, 0, sync, name, vers, sync2, name2, vers2);
+				break;
+			case 0:
+				break;
+			case 1:
+				FINDING(FindingOutOfDate, 0, sync2, name2, vers2, sync, name, vers);
+				break;
+			}
+		}
+	}
+}
+
+gboolean
+find_depends(alpm_list_t *d, const char *name)
+{
+	for (; d; d = alpm_list_next(d)) {
+		alpm_depend_t *n = d->data;
+
+		if (!strcmp(n->name, name))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+vcs_package(const struct dbhash *dbhash, void *pkg)
+{
+	const char *vcss[] = { "git", "svn", "cvs", "bzr", NULL };
+	const char *name = dbhash_pkg_get_name(dbhash, pkg);
+	const char **vcs;
+	size_t len = strlen(name);
+
+	/* named with a -git, -svn, -cvs or -bzr suffix */
+	if (len < 4 || name[len - 4] != '-')
+		return FALSE;
+	for (vcs = vcss; *vcs; vcs++) {
+		if (memcmp(name + len - 3, *vcs, 3))
+			continue;
+#if 0
+		/* why do binary packages have no makedepends? */
+		if (!find_depends(alpm_pkg_get_makedepends(pkg), *vcs)) {
+			alpm_db_t *db = alpm_pkg_get_db(pkg);
+			const char *sync = alpm_db_get_name(db);
+			DPRINTF(1, "%s/%s named %s but no makedepends %s\n", sync, name, name + len - 4, *vcs);
+			continue;
+		}
+#endif
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/* The conflicts of a package, as a small open-addressed hash set of names. */
+struct conflictset {
+	const char **slot;
+	size_t mask;
+	const char *local[32];
+};
+
+static void
+conflictset_init(struct conflictset *set, alpm_list_t *conflicts)
+{
+	size_t size = G_N_ELEMENTS(set->local), n = alpm_list_count(conflicts), h;
+
+	while (size < 2 * n)
+		size <<= 1;
+	if (size > G_N_ELEMENTS(set->local))
+		set->slot = calloc(size, sizeof(*set->slot));
+	else
+		set->slot = memset(set->local, 0, sizeof(set->local));
+	set->mask = size - 1;
+	for (; conflicts; conflicts = alpm_list_next(conflicts)) {
+		const char *name = ((alpm_depend_t *) conflicts->data)->name;
+
+		for (h = g_str_hash(name) & set->mask; set->slot[h]; h = (h + 1) & set->mask)
+			if (!strcmp(set->slot[h], name))
+				break;
+		set->slot[h] = name;
+	}
+}
+
+static gboolean
+conflictset_contains(const struct conflictset *set, const char *name)
+{
+	size_t h;
+
+	for (h = g_str_hash(name) & set->mask; set->slot[h]; h = (h + 1) & set->mask)
+		if (!strcmp(set->slot[h], name))
+			return TRUE;
+	return FALSE;
+}
+
+static void
+conflictset_free(struct conflictset *set)
+{
+	if (set->slot != set->local)
+		free(set->slot);
+}
+
+/** @brief check the provisions of a package that it also conflicts with
+  * @param vcs - whether for the VCSCHECK rather than the PROVIDES analysis
+  */
+static void
+check_provisions(GSList *s, const struct pkgitem *item, gboolean vcs)
+{
+	struct dbhash *dbhash = s->data;
+	struct conflictset conflicts;
+
+	/* nothing to do for a package without conflicts */
+	if (!item->conflicts)
+		return;
+	conflictset_init(&conflicts, item->conflicts);
 	const char *sync = dbhash->name;
-	const char *name = alpm_pkg_get_name(pkg);
-	const char *vers = alpm_pkg_get_version(pkg);
-	for (GSList *n = s->next; n; n = n->next) {
-		struct dbhash *dbhash2 = n->data;
+	const char *name = item->name;
+	const char *vers = item->version;
+	for (alpm_list_t *p = item->provides; p; p = alpm_list_next(p)) {
+		alpm_depend_t *d = p->data;
+		const char *namep = d->name ? : name;
+		const char *versp = d->version;
+		if (d->mod == ALPM_DEP_MOD_ANY) {
+			versp = vers;
+		} else if (d->mod == ALPM_DEP_MOD_EQ) {
+			versp = d->version;
+		}
+		if (!conflictset_contains(&conflicts, namep))
+			continue;
+		for (GSList *n = s->next; n; n = n->next) {
+			struct dbhash *dbhash2 = n->data;
+			void *pkg2;
+			if ((pkg2 = dbhash_lookup(dbhash2, namep))) {
+				const char *sync2 = dbhash2->name;
+				const char *name2 = dbhash_pkg_get_name(dbhash2, pkg2);
+				const char *vers2 = dbhash_pkg_get_version(dbhash2, pkg2);
+
+				FINDING(vcs ? FindingVcsPackage : FindingProvides, 0, sync, name, vcs ? vers : versp,
+					sync2, name2, vers2);
+				if (versp != vers)
+					FINDING(FindingProvidesVersion, 2, sync, name, vers, NULL, name2, versp);
+				if (versp) {
+					switch (pac_vercmp(dbhash, versp, dbhash2, vers2)) {
+					case -1:
+						if (versp != vers) {
+							FINDING(FindingOutOfDate, 0, sync, name, vcs ? versp : vers, sync2, name2, vers2);
+						} else {
+							FINDING(FindingCouldBeOutOfDate, 0, sync, name, versp, sync2, name2, vers2,
+								.action = ActionAddProvidesVersion);
+						}
+						break;
+					case 0:
+						if (versp != vers) {
+							FINDING(FindingUpToDate, vcs ? 2 : 1, sync, name, versp, sync2, name2, vers2);
+						} else {
+							FINDING(FindingAppearsUpToDate, vcs ? 2 : 1, sync, name, versp, sync2, name2, vers2,
+								.action = ActionAddProvidesVersion);
+						}
+						break;
+					case 1:
+						if (versp != vers) {
+							FINDING(FindingOutOfDate, 0, sync2, name2, vers2, sync, name, versp);
+						} else {
+							FINDING(FindingCouldBeOutOfDate, 0, sync2, name2, vers2, sync, name, versp,
+								.action = ActionAddProvidesVersion, .action_related = TRUE);
+						}
+						break;
+					}
+				}
+			}
+		}
+	}
+	conflictset_free(&conflicts);
+}
+
+void
+check_provides(GSList *s, const struct pkgitem *item)
+{
+	if (!item->vcs)
+		check_provisions(s, item, FALSE);
+}
+
+void
+check_vcscheck(GSList *s, const struct pkgitem *item)
+{
+	if (item->vcs)
+		check_provisions(s, item, TRUE);
+}
+
+void
+check_stranded_local(GSList *slist, const struct pkgitem *item)
+{
+	struct dbhash *dbhash = slist->data;
+	const char *sync = dbhash->name;
+	const char *name = item->name;
+	const char *vers = item->version;
+	int found = 0;
+	GSList *s;
+
+	/* skip local database */
+	for (s = slist->next; s; s = s->next) {
+		dbhash = s->data;
+		if (dbhash_lookup(dbhash, name)) {
+			found = 1;
+			break;
+		}
+	}
+	if (!found) {
+		/* Package from local database not found in any other sync database. This 
+		   package, by definition is foreign.  Without checking the AUR, this
+		   package will be marked foreign.  When we can check the AUR and it
+		   exists in the AUR, this package is marked stranded.  When it does not
+		   exist in the AUR, it is marked as foreign. */
+		/* If the package exists in the AUR and the AUR package version is newer
+		   than that of the package, mark it as out of date. */
+
+		aur_pkg_t *pkg2;
+		struct dbhash *dbhash2 = aur_db_get();
+
+		if ((pkg2 = dbhash_lookup(dbhash2, name))) {
+			const char *sync2 = dbhash2->name;
+			const char *name2 = aur_pkg_get_base(pkg2);
+			const char *vers2 = aur_pkg_get_version(pkg2);
+
+			FINDING(FindingDivorced, 0, sync, name, vers, sync2, name2, vers2);
+
+			switch (pac_vercmp(slist->data, vers, dbhash2, vers2)) {
+			case -1:
+				FINDING(FindingOutOfDate, 0, sync, name, vers, sync2, name2, vers2,
+					.action = ActionRebuild);
+				break;
+			case 0:
+				break;
+			case 1:
+				if (!item->vcs)
+					FINDING(FindingOutOfDate, 0, sync2, name2, vers2, sync, name, vers);
+				break;
+			}
+			if (!pkg2->maintainer)
+				FINDING(FindingOrphan, 0, sync2, name2, vers2, .action = ActionAdopt);
+		} else {
+			FINDING(FindingForeign, 0, sync, name, vers);
+		}
+	}
+}
+
+/** @brief compare a package of a custom database with its AUR package */
+static void
+aur_compare_custom(struct dbhash *dbhash, const struct pkgitem *item, struct dbhash *dbhash2, aur_pkg_t *pkg2)
+{
+	const char *sync = dbhash->name;
+	const char *name = item->name;
+	const char *vers = item->version;
+	const char *sync2 = dbhash2->name;
+	const char *name2 = aur_pkg_get_base(pkg2);
+	const char *vers2 = aur_pkg_get_version(pkg2);
+
+	switch (pac_vercmp(dbhash, vers, dbhash2, vers2)) {
+	case -1:
+		FINDING(FindingBuiltFrom, 0, sync, name, vers, sync2, name2, vers2);
+		FINDING(FindingOutOfDate, 0, sync, name, vers, sync2, name2, vers2,
+			.action = ActionRebuild);
+		break;
+	case 0:
+		FINDING(FindingBuiltFrom, 2, sync, name, vers, sync2, name2, vers2);
+		break;
+	case 1:
+		FINDING(FindingBuiltFrom, 0, sync, name, vers, sync2, name2, vers2);
+		if (!item->vcs)
+			FINDING(FindingOutOfDate, 0, sync2, name2, vers2, sync, name, vers);
+		break;
+	}
+
+	if (!pkg2->maintainer)
+		FINDING(FindingOrphan, 0, sync2, name2, vers2, .action = ActionAdopt);
+}
+
+void
+check_stranded_custom(GSList *s, const struct pkgitem *item)
+{
+	if (!aur_enabled())
+		return;
+
+	struct dbhash *dbhash = s->data;
+	const char *sync = dbhash->name;
+	const char *name = item->name;
+	const char *vers = item->version;
+
+	aur_pkg_t *pkg2;
+	struct dbhash *dbhash2 = aur_db_get();
+
+	if ((pkg2 = dbhash_lookup(dbhash2, name))) {
+		/* the AURCHECK analysis reports on packages in the AUR */
+		if (!(options.analyses & PACANA_ANALYSIS_AURCHECK))
+			aur_compare_custom(dbhash, item, dbhash2, pkg2);
+	} else if (aur_known(name)) {
+		FINDING(FindingStranded, 0, sync, name, vers);
+	}
+}
+
+/** @brief check a package of the local or a custom database for the STRANDED
+  * analysis (the local database is never custom)
+  */
+void
+check_stranded(GSList *s, const struct pkgitem *item)
+{
+	if (((struct dbhash *) s->data)->custom)
+		check_stranded_custom(s, item);
+	else
+		check_stranded_local(s, item);
+}
+
+/** @brief check a package of a custom database against the AUR
+  *
+  * Uses the AUR packages already looked up for the package names of custom
+  * databases, which the STRANDED analysis uses too, so never looks up
+  * anything.
+  */
+void
+check_aurcheck(GSList *s, const struct pkgitem *item)
+{
+	if (!aur_enabled())
+		return;
+
+	struct dbhash *dbhash = s->data;
+	const char *sync = dbhash->name;
+	const char *name = item->name;
+	const char *vers = item->version;
+
+	aur_pkg_t *pkg2;
+	struct dbhash *dbhash2 = aur_db_get();
+
+	if ((pkg2 = dbhash_lookup(dbhash2, name))) {
+		aur_compare_custom(dbhash, item, dbhash2, pkg2);
+		if (pkg2->outofdate)
+			FINDING(FindingFlagged, 0, dbhash2->name, aur_pkg_get_base(pkg2), aur_pkg_get_version(pkg2));
+	} else if (!(options.analyses & PACANA_ANALYSIS_STRANDED) && aur_known(name)) {
+		/* otherwise reported by the STRANDED analysis */
+		FINDING(FindingStranded, 0, sync, name, vers);
+	}
+}
+
+void
+check_missing(GSList *s, const struct pkgitem *item)
+{
+	struct dbhash *dbhash = s->data;
+	const char *sync = dbhash->name;
+	const char *name = item->name;
+	const char *vers = item->version;
+
+	alpm_list_t *d;
+
+	for (d = item->depends; d; d = alpm_list_next(d)) {
+		alpm_depend_t *dep = d->data;
+
+		const char *dname = dep->name;
+
+		if (!idset_contains(provided, strtab_find(&names, dname))) {
+			if (aur_enabled() && aur_known(dname)) {
+				aur_pkg_t *pkg2;
+				struct dbhash *dbhash2 = aur_db_get();
+
+				if ((pkg2 = dbhash_lookup(dbhash2, dname))) {
+					const char *sync2 = dbhash2->name;
+					const char *name2 = aur_pkg_get_base(pkg2);
+					const char *vers2 = aur_pkg_get_version(pkg2);
+
+					FINDING(FindingNeeds, 0, sync, name, vers, sync2, name2, vers2,
+						.depend = dname, .action = ActionBuild);
+					if (!pkg2->maintainer)
+						FINDING(FindingOrphan, 0, sync2, name2, vers2, .action = ActionAdopt);
+				} else {
+					FINDING(FindingMissing, 0, sync, name, vers,
+						.depend = dname, .action = ActionCreate);
+				}
+			} else {
+				FINDING(FindingMissing, 0, sync, name, vers,
+					.depend = dname, .action = ActionFind);
+			}
+		}
+	}
+
+}
+
+/* a package providing a name, in the inverted provides index */
+struct provider {
+	struct dbhash *dbhash;
+	void *pkg;
+	const char *name;		/* of the package */
+	uint32_t nameid;		/* of the package */
+	const char *version;		/* provided, or NULL */
+};
+
+/* Providers of each interned name: those of id are entries start[id] up to
+   start[id + 1], in database priority order. */
+struct provindex {
+	uint32_t *start;
+	struct provider *entries;
+	uint32_t nids;
+};
+
+/** @brief add (or count, when entries is NULL) the providers of a package */
+static void
+provindex_package(struct provindex *idx, struct dbhash *dbhash, void *pkg, uint32_t *fill)
+{
+	const char *name = dbhash_pkg_get_name(dbhash, pkg);
+	uint32_t nameid = strtab_find(&names, name), id;
+	alpm_list_t *d = NULL;
+
+	/* a package provides its own name at its own version */
+	for (id = nameid;; id = strtab_find(&names, ((alpm_depend_t *) d->data)->name)) {
+		if (id && id < idx->nids) {
+			if (!idx->entries)
+				idx->start[id]++;
+			else {
+				struct provider *e = &idx->entries[fill[id]++];
+
+				e->dbhash = dbhash;
+				e->pkg = pkg;
+				e->name = name;
+				e->nameid = nameid;
+				if (!d)
+					e->version = dbhash_pkg_get_version(dbhash, pkg);
+				else
+					e->version = ((alpm_depend_t *) d->data)->version;
+			}
+		}
+		if (!(d = d ? alpm_list_next(d) : dbhash_pkg_get_provides(dbhash, pkg)))
+			break;
+	}
+}
+
+/** @brief build the inverted provides index of the databases of a root
+  *
+  * Two passes over the packages: the first counts the providers of each name,
+  * the second places them, so that the providers of a name are contiguous.
+  */
+static void
+provindex_build(struct provindex *idx, GSList *slist)
+{
+	uint32_t id, total = 0, *fill;
+	GSList *s;
+	alpm_list_t *p;
+	int pass;
+
+	idx->nids = names.count + 1;
+	idx->start = calloc(idx->nids + 1, sizeof(*idx->start));
+	idx->entries = NULL;
+	fill = NULL;
+	for (pass = 0; pass < 2; pass++) {
+		for (s = slist; s; s = s->next) {
+			struct dbhash *dbhash = s->data;
+
+			for (p = dbhash->pkgs; p; p = alpm_list_next(p))
+				provindex_package(idx, dbhash, p->data, fill);
+		}
+		if (pass)
+			break;
+		/* counts to starting positions */
+		for (id = 0; id < idx->nids; id++) {
+			uint32_t count = idx->start[id];
+
+			idx->start[id] = total;
+			total += count;
+		}
+		idx->start[idx->nids] = total;
+		idx->entries = calloc(total ? total : 1, sizeof(*idx->entries));
+		fill = malloc(idx->nids * sizeof(*fill));
+		memcpy(fill, idx->start, idx->nids * sizeof(*fill));
+	}
+	free(fill);
+}
+
+static void
+provindex_free(struct provindex *idx)
+{
+	free(idx->start);
+	free(idx->entries);
+	memset(idx, 0, sizeof(*idx));
+}
+
+/** @brief report names provided by more than one package
+  * @param slist - the databases of a root, local database first
+  * @param only - only report the providers of, or alternates to, this name
+  *
+  * Each name with more than one provider is visited once in the inverted
+  * provides index.  A package found in several databases (such as an
+  * installed package and the sync package it was installed from) is only
+  * considered once, at its highest priority.  Each alternate is reported with
+  * respect to the highest priority provider, and each alternate providing an
+  * older version than the newest provided version is warned about, so that
+  * the analysis is linear in the number of provides.
+  */
+void
+analyze_alternate(GSList *slist, const char *only)
+{
+	struct provindex idx;
+	struct provider **alts;
+	uint32_t *seen, id, i, n, max = 0;
+
+	provindex_build(&idx, slist);
+	/* for each package name, the last name for which it was seen */
+	seen = calloc(idx.nids, sizeof(*seen));
+	for (id = 1; id < idx.nids; id++)
+		max = MAX(max, idx.start[id + 1] - idx.start[id]);
+	alts = calloc(max ? max : 1, sizeof(*alts));
+	for (id = 1; id < idx.nids; id++) {
+		const char *provision = names.strs[id];
+		struct provider *newest = NULL;
+		gboolean wanted = !only || !strcmp(provision, only);
+
+		if (idx.start[id + 1] - idx.start[id] < 2)
+			continue;
+		for (n = 0, i = idx.start[id]; i < idx.start[id + 1]; i++) {
+			struct provider *e = &idx.entries[i];
+
+			if (seen[e->nameid] == id)
+				continue;
+			seen[e->nameid] = id;
+			alts[n++] = e;
+			if (only && !strcmp(e->name, only))
+				wanted = TRUE;
+		}
+		if (n < 2 || !wanted)
+			continue;
+		for (i = 0; i < n; i++) {
+			struct provider *e = alts[i];
+
+			if (i && e->dbhash->select > 0)
+				FINDING(FindingAlternate, 1, e->dbhash->name, e->name,
+					dbhash_pkg_get_version(e->dbhash, e->pkg), alts[0]->dbhash->name, alts[0]->name,
+					dbhash_pkg_get_version(alts[0]->dbhash, alts[0]->pkg), .depend = provision);
+			if (e->version && (!newest || pac_vercmp(e->dbhash, e->version, newest->dbhash,
+								 newest->version) > 0))
+				newest = e;
+		}
+		for (i = 0; newest && i < n; i++) {
+			struct provider *e = alts[i];
+
+			if (e->version && e->dbhash->select > 0
+			    && pac_vercmp(e->dbhash, e->version, newest->dbhash, newest->version) < 0)
+				FINDING(FindingAlternateVersion, 0, e->dbhash->name, e->name, e->version,
+					newest->dbhash->name, newest->name, newest->version, .depend = provision);
+		}
+	}
+	free(alts);
+	free(seen);
+	provindex_free(&idx);
+}
+
+/** @brief compare installed packages with the sync databases
+  * @param slist - the databases of a root, local database first
+  * @param only - only report packages of this name, or NULL
+  *
+  * Reports packages in the local database that are older than the package of
+  * the same name in the highest priority sync database that has one, which is
+  * the package that pacman would upgrade to, and those that are newer.  The
+  * local database and each sync database are walked once, in name order and in
+  * step, so that no package is looked up by name.
+  */
+void
+analyze_outdated(GSList *slist, const char *only)
+{
+	struct dbhash *dbhash = slist->data;
+	const char *sync = dbhash->name;
+	guint nsyncs = g_slist_length(slist->next), j;
+	struct dbhash **syncs;
+	size_t *pos, i;
+	GSList *s;
+
+	if (dbhash->select <= 0)
+		return;
+	syncs = calloc(nsyncs, sizeof(*syncs));
+	pos = calloc(nsyncs, sizeof(*pos));
+	/* skip local database */
+	for (j = 0, s = slist->next; s; s = s->next, j++)
+		syncs[j] = s->data;
+	for (i = 0; i < dbhash->nsorted; i++) {
+		const char *name = dbhash->sorted[i].name;
+		void *pkg = dbhash->sorted[i].pkg;
+
+		for (j = 0; j < nsyncs; j++) {
+			struct dbhash *dbhash2 = syncs[j];
+			const struct pkgname *sorted2 = dbhash2->sorted;
+
+			while (pos[j] < dbhash2->nsorted && strcmp(sorted2[pos[j]].name, name) < 0)
+				pos[j]++;
+			if (pos[j] < dbhash2->nsorted && !strcmp(sorted2[pos[j]].name, name))
+				break;
+		}
+		if (j == nsyncs || (only && strcmp(name, only)))
+			continue;
+
+		struct dbhash *dbhash2 = syncs[j];
+		void *pkg2 = dbhash2->sorted[pos[j]].pkg;
+		const char *vers = dbhash_pkg_get_version(dbhash, pkg);
 		const char *sync2 = dbhash2->name;
-		if (strstr(sync2, "testing"))
+		const char *vers2 = dbhash_pkg_get_version(dbhash2, pkg2);
+
+		switch (pac_vercmp(dbhash, vers, dbhash2, vers2)) {
+		case -1:
+			FINDING(FindingOutOfDate, 0, sync, name, vers, sync2, name, vers2);
+			break;
+		case 0:
+			break;
+		case 1:
+			if (!vcs_package(dbhash, pkg))
+				FINDING(FindingOutOfDate, 0, sync2, name, vers2, sync, name, vers);
+			break;
+		}
+	}
+	free(pos);
+	free(syncs);
+}
+
+void
+freeit(gpointer data)
+{
+	free(data);
+}
+
+struct dbhash *
+aur_db_get(void)
+{
+	struct dbhash *dbhash;
+
+	if (!(dbhash = aur_db)) {
+		dbhash = calloc(1, sizeof(*aur_db));
+		dbhash->refs = 1;
+		dbhash->name = strdup("aur");
+		dbhash->pkgs = NULL;
+		aur_db = dbhash;
+	}
+	return (dbhash);
+}
+
+static void
+aur_json_strings(struct json_object *pkg, const char *key, alpm_list_t **list)
+{
+	struct json_object *array, *obj;
+	size_t n, number;
+
+	if ((array = json_object_object_get(pkg, key))
+	    && json_object_is_type(array, json_type_array)) {
+		number = json_object_array_length(array);
+		for (n = 0; n < number; n++)
+			if ((obj = json_object_array_get_idx(array, n))
+			    && json_object_is_type(obj, json_type_string))
+				alpm_list_append_strdup(list, json_object_get_string(obj));
+	}
+}
+
+static void
+aur_json_depends(struct json_object *pkg, const char *key, alpm_list_t **list)
+{
+	struct json_object *array, *obj;
+	size_t n, number;
+
+	if ((array = json_object_object_get(pkg, key))
+	    && json_object_is_type(array, json_type_array)) {
+		number = json_object_array_length(array);
+		for (n = 0; n < number; n++)
+			if ((obj = json_object_array_get_idx(array, n))
+			    && json_object_is_type(obj, json_type_string))
+				alpm_list_append(list, alpm_dep_from_string(json_object_get_string(obj)));
+	}
+}
+
+/** @brief build an AUR package from a version 5 RPC result object
+  *
+  * This is used both for RPC results and for entries read back from the
+  * on-disk AUR cache, which stores packages in the same form.
+  */
+aur_pkg_t *
+aur_pkg_from_json(struct json_object *pkg)
+{
+	aur_pkg_t *aur_pkg;
+	struct json_object *obj;
+	const char *str;
+
+	if (!pkg || !json_object_is_type(pkg, json_type_object)) {
+		EPRINTF("Wrong object type.\n");
+		return (NULL);
+	}
+	if (!(obj = json_object_object_get(pkg, "Name")) || !(str = json_object_get_string(obj))) {
+		EPRINTF("AUR Package has no name.\n");
+		return (NULL);
+	}
+	aur_pkg = calloc(1, sizeof(*aur_pkg));
+	aur_pkg->name = strdup(str);
+	if ((obj = json_object_object_get(pkg, "PackageBase")) && (str = json_object_get_string(obj)))
+		aur_pkg->base = strdup(str);
+	if ((obj = json_object_object_get(pkg, "Version")) && (str = json_object_get_string(obj)))
+		aur_pkg->version = strdup(str);
+	if ((obj = json_object_object_get(pkg, "Description")) && (str = json_object_get_string(obj)))
+		aur_pkg->desc = strdup(str);
+	if ((obj = json_object_object_get(pkg, "URL")) && (str = json_object_get_string(obj)))
+		aur_pkg->url = strdup(str);
+	aur_json_strings(pkg, "License", &aur_pkg->licenses);
+	aur_json_strings(pkg, "Groups", &aur_pkg->groups);
+	aur_json_depends(pkg, "Depends", &aur_pkg->depends);
+	aur_json_depends(pkg, "OptDepends", &aur_pkg->optdepends);
+	aur_json_depends(pkg, "CheckDepends", &aur_pkg->checkdepends);
+	aur_json_depends(pkg, "MakeDepends", &aur_pkg->makedepends);
+	aur_json_depends(pkg, "Conflicts", &aur_pkg->conflicts);
+	aur_json_depends(pkg, "Provides", &aur_pkg->provides);
+	aur_json_depends(pkg, "Replaces", &aur_pkg->replaces);
+	if ((obj = json_object_object_get(pkg, "Maintainer"))
+			&& json_object_is_type(obj, json_type_string)
+			&& (str = json_object_get_string(obj))) {
+		aur_pkg->maintainer = strdup(str);
+	}
+	if ((obj = json_object_object_get(pkg, "OutOfDate")) && json_object_is_type(obj, json_type_int))
+		aur_pkg->outofdate = json_object_get_int64(obj);
+	return (aur_pkg);
+}
+
+static void
+aur_json_add_string(struct json_object *pkg, const char *key, const char *str)
+{
+	if (str)
+		json_object_object_add(pkg, key, json_object_new_string(str));
+}
+
+static void
+aur_json_add_strings(struct json_object *pkg, const char *key, alpm_list_t *list)
+{
+	struct json_object *array;
+
+	if (!list)
+		return;
+	array = json_object_new_array();
+	for (; list; list = alpm_list_next(list))
+		json_object_array_add(array, json_object_new_string(list->data));
+	json_object_object_add(pkg, key, array);
+}
+
+static void
+aur_json_add_depends(struct json_object *pkg, const char *key, alpm_list_t *list)
+{
+	struct json_object *array;
+
+	if (!list)
+		return;
+	array = json_object_new_array();
+	for (; list; list = alpm_list_next(list)) {
+		char *str = alpm_dep_compute_string(list->data);
+
+		json_object_array_add(array, json_object_new_string(str));
+		free(str);
+	}
+	json_object_object_add(pkg, key, array);
+}
+
+/** @brief the inverse of aur_pkg_from_json() */
+struct json_object *
+aur_pkg_to_json(aur_pkg_t *aur_pkg)
+{
+	struct json_object *pkg = json_object_new_object();
+
+	aur_json_add_string(pkg, "Name", aur_pkg->name);
+	aur_json_add_string(pkg, "PackageBase", aur_pkg->base);
+	aur_json_add_string(pkg, "Version", aur_pkg->version);
+	aur_json_add_string(pkg, "Description", aur_pkg->desc);
+	aur_json_add_string(pkg, "URL", aur_pkg->url);
+	aur_json_add_strings(pkg, "License", aur_pkg->licenses);
+	aur_json_add_strings(pkg, "Groups", aur_pkg->groups);
+	aur_json_add_depends(pkg, "Depends", aur_pkg->depends);
+	aur_json_add_depends(pkg, "OptDepends", aur_pkg->optdepends);
+	aur_json_add_depends(pkg, "CheckDepends", aur_pkg->checkdepends);
+	aur_json_add_depends(pkg, "MakeDepends", aur_pkg->makedepends);
+	aur_json_add_depends(pkg, "Conflicts", aur_pkg->conflicts);
+	aur_json_add_depends(pkg, "Provides", aur_pkg->provides);
+	aur_json_add_depends(pkg, "Replaces", aur_pkg->replaces);
+	aur_json_add_string(pkg, "Maintainer", aur_pkg->maintainer);
+	if (aur_pkg->outofdate)
+		json_object_object_add(pkg, "OutOfDate", json_object_new_int64(aur_pkg->outofdate));
+	return (pkg);
+}
+
+void
+aur_pkg_free(aur_pkg_t *aur_pkg)
+{
+	free(aur_pkg->base);
+	free(aur_pkg->name);
+	free(aur_pkg->version);
+	free(aur_pkg->desc);
+	free(aur_pkg->url);
+	FREELIST(aur_pkg->licenses);
+	FREELIST(aur_pkg->groups);
+	FREEDEPS(aur_pkg->depends);
+	FREEDEPS(aur_pkg->optdepends);
+	FREEDEPS(aur_pkg->checkdepends);
+	FREEDEPS(aur_pkg->makedepends);
+	FREEDEPS(aur_pkg->conflicts);
+	FREEDEPS(aur_pkg->provides);
+	FREEDEPS(aur_pkg->replaces);
+	free(aur_pkg->maintainer);
+	free(aur_pkg);
+}
+
+void
+aur_db_add(aur_pkg_t *aur_pkg)
+{
+	struct dbhash *dbhash = aur_db_get();
+
+	if (dbhash_lookup(dbhash, aur_pkg->name)) {
+		DPRINTF(1, "AUR package: %s/%s (duplicate)\n", dbhash->name, aur_pkg->name);
+		aur_pkg_free(aur_pkg);
+		return;
+	}
+	alpm_list_append(&dbhash->pkgs, aur_pkg);
+	dbhash_insert(dbhash, aur_pkg->name, aur_pkg);
+	dbhash_verkey_add(dbhash, aur_pkg_get_version(aur_pkg));
+	DPRINTF(1, "AUR package: %s/%s\n", dbhash->name, aur_pkg->name);
+}
+
+/** @brief forget all AUR packages, so that they are looked up again */
+void
+aur_db_clear(void)
+{
+	alpm_list_t *p;
+
+	if (!aur_db)
+		return;
+	for (p = aur_db->pkgs; p; p = alpm_list_next(p))
+		aur_pkg_free(p->data);
+	alpm_list_free(aur_db->pkgs);
+	aur_db->pkgs = NULL;
+	/* also forgets the comparisons of their versions */
+	destroy_dbhash(aur_db);
+	aur_db = NULL;
+}
+
+/** @} */
+
+/** @section AUR Response Parser
+  * @{ */
+
+/*
+ * AUR responses are parsed incrementally as they arrive by a small streaming
+ * tokenizer rather than by collecting the whole response and building a
+ * json-c object tree.  Only the fields of each result listed in aur_fields[]
+ * are copied out of the response; all other values are scanned over without
+ * being stored, so memory and time spent are proportional to the fields used
+ * rather than to the size of the response.
+ */
+
+enum aur_field_type {
+	AUR_FIELD_STRING,		/* char * */
+	AUR_FIELD_STRINGS,		/* alpm_list_t * of char * */
+	AUR_FIELD_DEPENDS,		/* alpm_list_t * of alpm_depend_t * */
+	AUR_FIELD_TIME,			/* time_t, from a number or null */
+};
+
+struct aur_field {
+	const char *key;
+	enum aur_field_type type;
+	size_t offset;
+};
+
+/* RPC result fields used by the analyses: add a field here to have it
+   extracted into the aur_pkg_t. */
+static const struct aur_field aur_fields[] = {
+	/* *INDENT-OFF* */
+	{ "Name",		AUR_FIELD_STRING,	offsetof(aur_pkg_t, name)	},
+	{ "PackageBase",	AUR_FIELD_STRING,	offsetof(aur_pkg_t, base)	},
+	{ "Version",		AUR_FIELD_STRING,	offsetof(aur_pkg_t, version)	},
+	{ "Maintainer",		AUR_FIELD_STRING,	offsetof(aur_pkg_t, maintainer)	},
+	{ "OutOfDate",		AUR_FIELD_TIME,		offsetof(aur_pkg_t, outofdate)	},
+	{ NULL, }
+	/* *INDENT-ON* */
+};
+
+#define AUR_PARSER_MAXDEPTH	32
+
+enum aur_parser_state {
+	AUR_PARSE_TOKEN,		/* between tokens */
+	AUR_PARSE_STRING,		/* within a string */
+	AUR_PARSE_ESCAPE,		/* after a backslash within a string */
+	AUR_PARSE_UNICODE,		/* within a \uXXXX escape */
+	AUR_PARSE_SCALAR,		/* within a number or literal */
+};
+
+struct aur_parser {
+	enum aur_parser_state state;
+	int depth;			/* number of open containers */
+	char stack[AUR_PARSER_MAXDEPTH];	/* '{' or '[' for each container */
+	gboolean expect_key;		/* next string is an object key */
+	gboolean capture;		/* current string is being stored */
+	int pkgdepth;			/* depth of result objects */
+	GString *str;			/* current string or scalar */
+	unsigned int ucode;		/* \uXXXX escape being decoded */
+	int uhex;			/* number of hex digits of ucode seen */
+	unsigned int surrogate;		/* pending UTF-16 high surrogate */
+	char topkey[16];		/* current key of the root object */
+	const struct aur_field *field;	/* field of the current result key */
+	aur_pkg_t *pkg;			/* result being built */
+	GHashTable *want;		/* names of results to keep (NULL for all) */
+	/* members of the root object */
+	int version;
+	char type[16];
+	int resultcount;
+	char *error;
+	size_t count;			/* number of results parsed */
+	int err;
+};
+
+void
+aur_parser_init(struct aur_parser *p)
+{
+	memset(p, 0, sizeof(*p));
+	p->state = AUR_PARSE_TOKEN;
+	p->pkgdepth = 3;		/* { "results": [ { ... } ] } */
+	p->resultcount = -1;
+	p->str = g_string_sized_new(64);
+}
+
+void
+aur_parser_free(struct aur_parser *p)
+{
+	if (p->pkg)
+		aur_pkg_free(p->pkg);
+	p->pkg = NULL;
+	if (p->str)
+		g_string_free(p->str, TRUE);
+	p->str = NULL;
+	free(p->error);
+	p->error = NULL;
+}
+
+static const struct aur_field *
+aur_field_lookup(const char *key)
+{
+	const struct aur_field *f;
+
+	for (f = aur_fields; f->key; f++)
+		if (!strcmp(f->key, key))
+			return (f);
+	return (NULL);
+}
+
+static gboolean
+aur_parser_in_results(struct aur_parser *p)
+{
+	/* about to open a result object */
+	return (p->depth == p->pkgdepth - 1 && p->stack[p->depth - 1] == '['
+		&& (p->pkgdepth == 2 || !strcmp(p->topkey, "results")));
+}
+
+static gboolean
+aur_parser_wanted(struct aur_parser *p)
+{
+	if (p->expect_key)
+		return (TRUE);
+	if (p->depth == 1 && p->pkgdepth == 3)
+		return (TRUE);
+	if (!p->pkg || !p->field)
+		return (FALSE);
+	if (p->depth == p->pkgdepth)
+		return (p->field->type == AUR_FIELD_STRING);
+	if (p->depth == p->pkgdepth + 1 && p->stack[p->depth - 1] == '[')
+		return (p->field->type == AUR_FIELD_STRINGS || p->field->type == AUR_FIELD_DEPENDS);
+	return (FALSE);
+}
+
+/** @brief a string or scalar value has been completed */
+static void
+aur_parser_value(struct aur_parser *p, gboolean string)
+{
+	const char *val = p->str->str;
+
+	if (p->depth == 1 && p->pkgdepth == 3) {
+		if (!strcmp(p->topkey, "version") && !string)
+			p->version = atoi(val);
+		else if (!strcmp(p->topkey, "resultcount") && !string)
+			p->resultcount = atoi(val);
+		else if (!strcmp(p->topkey, "type") && string)
+			g_strlcpy(p->type, val, sizeof(p->type));
+		else if (!strcmp(p->topkey, "error") && string) {
+			free(p->error);
+			p->error = strdup(val);
+		}
+		return;
+	}
+	if (!p->pkg || !p->field)
+		return;
+	if (p->field->type == AUR_FIELD_TIME) {
+		/* null is taken as zero */
+		if (p->depth == p->pkgdepth && !string)
+			*(time_t *) ((char *) p->pkg + p->field->offset) = strtoll(val, NULL, 10);
+		return;
+	}
+	if (!string)
+		return;
+	if (p->depth == p->pkgdepth) {
+		char **where = (char **) ((char *) p->pkg + p->field->offset);
+
+		if (p->field->type != AUR_FIELD_STRING)
+			return;
+		free(*where);
+		*where = strdup(val);
+	} else if (p->depth == p->pkgdepth + 1) {
+		alpm_list_t **where = (alpm_list_t **) ((char *) p->pkg + p->field->offset);
+
+		switch (p->field->type) {
+		case AUR_FIELD_STRING:
+		case AUR_FIELD_TIME:
+			break;
+		case AUR_FIELD_STRINGS:
+			alpm_list_append_strdup(where, val);
+			break;
+		case AUR_FIELD_DEPENDS:
+			alpm_list_append(where, alpm_dep_from_string(val));
+			break;
+		}
+	}
+}
+
+/** @brief a string has been completed */
+static void
+aur_parser_string(struct aur_parser *p)
+{
+	if (!p->expect_key) {
+		aur_parser_value(p, TRUE);
+		return;
+	}
+	if (p->depth == 1)
+		g_strlcpy(p->topkey, p->str->str, sizeof(p->topkey));
+	else if (p->depth == p->pkgdepth && p->pkg)
+		p->field = aur_field_lookup(p->str->str);
+}
+
+static void
+aur_parser_unicode(struct aur_parser *p)
+{
+	char buf[8];
+	unsigned int c = p->ucode;
+	int len;
+
+	if (c >= 0xd800 && c < 0xdc00) {
+		p->surrogate = c;
+		return;
+	}
+	if (c >= 0xdc00 && c < 0xe000) {
+		if (!p->surrogate)
+			return;
+		c = 0x10000 + ((p->surrogate - 0xd800) << 10) + (c - 0xdc00);
+	}
+	p->surrogate = 0;
+	len = g_unichar_to_utf8(c, buf);
+	g_string_append_len(p->str, buf, len);
+}
+
+static int
+aur_parser_token(struct aur_parser *p, char c)
+{
+	switch (c) {
+	case ' ':
+	case '\t':
+	case '\n':
+	case '\r':
+		return (0);
+	case '{':
+	case '[':
+		if (p->depth >= AUR_PARSER_MAXDEPTH)
+			return (-1);
+		if (c == '{' && aur_parser_in_results(p)) {
+			if (p->pkg)
+				aur_pkg_free(p->pkg);
+			p->pkg = calloc(1, sizeof(*p->pkg));
+			p->field = NULL;
+		}
+		p->stack[p->depth++] = c;
+		p->expect_key = (c == '{');
+		return (0);
+	case '}':
+	case ']':
+		if (!p->depth || p->stack[p->depth - 1] != (c == '}' ? '{' : '['))
+			return (-1);
+		if (c == '}' && p->depth == p->pkgdepth && p->pkg) {
+			if (p->pkg->name) {
+				if (!p->want || g_hash_table_contains(p->want, p->pkg->name)) {
+					aur_db_add(p->pkg);
+					p->count++;
+				} else
+					aur_pkg_free(p->pkg);
+			} else {
+				EPRINTF("AUR Package has no name.\n");
+				aur_pkg_free(p->pkg);
+			}
+			p->pkg = NULL;
+			p->field = NULL;
+		}
+		p->depth--;
+		p->expect_key = FALSE;
+		return (0);
+	case ',':
+		if (!p->depth)
+			return (-1);
+		p->expect_key = (p->stack[p->depth - 1] == '{');
+		return (0);
+	case ':':
+		if (!p->depth || p->stack[p->depth - 1] != '{')
+			return (-1);
+		p->expect_key = FALSE;
+		return (0);
+	case '"':
+		p->state = AUR_PARSE_STRING;
+		p->capture = aur_parser_wanted(p);
+		g_string_truncate(p->str, 0);
+		return (0);
+	default:
+		if (isalnum((unsigned char) c) || c == '-') {
+			p->state = AUR_PARSE_SCALAR;
+			g_string_truncate(p->str, 0);
+			g_string_append_c(p->str, c);
+			return (0);
+		}
+		return (-1);
+	}
+}
+
+/** @brief feed a chunk of response data to the parser
+  * @return zero on success, -1 on a syntax error
+  */
+int
+aur_parser_feed(struct aur_parser *p, const char *data, size_t len)
+{
+	const char *end = data + len;
+
+	if (p->err)
+		return (p->err);
+	for (; data < end; data++) {
+		char c = *data;
+
+		switch (p->state) {
+		case AUR_PARSE_TOKEN:
+			if (aur_parser_token(p, c))
+				goto error;
+			break;
+		case AUR_PARSE_STRING:
+			if (c == '"') {
+				p->state = AUR_PARSE_TOKEN;
+				if (p->capture)
+					aur_parser_string(p);
+			} else if (c == '\\') {
+				p->state = AUR_PARSE_ESCAPE;
+			} else if (p->capture) {
+				const char *q = data + 1;
+
+				/* copy the run of plain characters at once */
+				while (q < end && *q != '"' && *q != '\\')
+					q++;
+				g_string_append_len(p->str, data, q - data);
+				data = q - 1;
+			}
+			break;
+		case AUR_PARSE_ESCAPE:
+			p->state = AUR_PARSE_STRING;
+			if (c == 'u') {
+				p->state = AUR_PARSE_UNICODE;
+				p->ucode = 0;
+				p->uhex = 0;
+				break;
+			}
+			if (!p->capture)
+				break;
+			switch (c) {
+			case 'b':
+				c = '\b';
+				break;
+			case 'f':
+				c = '\f';
+				break;
+			case 'n':
+				c = '\n';
+				break;
+			case 'r':
+				c = '\r';
+				break;
+			case 't':
+				c = '\t';
+				break;
+			}
+			g_string_append_c(p->str, c);
+			break;
+		case AUR_PARSE_UNICODE:
+			if (!isxdigit((unsigned char) c))
+				goto error;
+			p->ucode = (p->ucode << 4) | g_ascii_xdigit_value(c);
+			if (++p->uhex == 4) {
+				p->state = AUR_PARSE_STRING;
+				if (p->capture)
+					aur_parser_unicode(p);
+			}
+			break;
+		case AUR_PARSE_SCALAR:
+			if (isalnum((unsigned char) c) || c == '.' || c == '+' || c == '-') {
+				g_string_append_c(p->str, c);
+				break;
+			}
+			p->state = AUR_PARSE_TOKEN;
+			aur_parser_value(p, FALSE);
+			if (aur_parser_token(p, c))
+				goto error;
+			break;
+		}
+	}
+	return (0);
+      error:
+	EPRINTF("Could not parse data: unexpected '%c'\n", *data);
+	p->err = -1;
+	return (p->err);
+}
+
+/** @brief check the response once all of it has been fed to the parser */
+int
+aur_parser_finish(struct aur_parser *p)
+{
+	if (p->err)
+		return (p->err);
+	if (p->state != AUR_PARSE_TOKEN || p->depth) {
+		EPRINTF("Could not parse data: unexpected end of data\n");
+		return (-1);
+	}
+	if (p->pkgdepth != 3)
+		return (0);
+	if (p->error) {
+		EPRINTF("AUR error: %s\n", p->error);
+		return (-1);
+	}
+	if (p->version != 5) {
+		EPRINTF("Result has wrong version.\n");
+		return (-1);
+	}
+	if (strcmp(p->type, "multiinfo")) {
+		EPRINTF("Result has wrong type.\n");
+		return (-1);
+	}
+	if (p->resultcount < 0) {
+		EPRINTF("Result has no resultcount.\n");
+		return (-1);
+	}
+	DPRINTF(1, "Parsed %zd AUR results\n", p->count);
+	return (0);
+}
+
+int
+parse_data(const char *data)
+{
+	struct aur_parser parser;
+	int err;
+
+	aur_parser_init(&parser);
+	if (!(err = aur_parser_feed(&parser, data, strlen(data))))
+		err = aur_parser_finish(&parser);
+	aur_parser_free(&parser);
+	return (err);
+}
+
+size_t
+writedata_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	struct aur_parser *parser = userdata;
+
+	if (aur_parser_feed(parser, ptr, size * nmemb))
+		return (0);
+	return (size * nmemb);
+}
+
+/** @} */
+
+/** @section AUR Requests
+  * @{ */
+
+struct aur_batch {
+	char *uri;			/* RPC request URI */
+	char *body;			/* form encoded POST body, or NULL for GET */
+	GSList *names;			/* names looked up (not owned) */
+	char *key;			/* of the names, for the AUR cache, or NULL */
+	struct curl_slist *headers;	/* request headers */
+	char *etag;			/* ETag of the response */
+	char *modified;			/* Last-Modified of the response */
+	struct aur_parser parser;	/* response parser */
+	int err;			/* result of the request */
+	gboolean rejected;		/* the RPC endpoint does not accept POST */
+	gboolean retry;			/* the request failed but may succeed later */
+	gboolean busy;			/* the AUR answered that it is overloaded */
+	long after;			/* Retry-After of the response, seconds */
+	int tries;			/* attempts made so far */
+	double due;			/* time before which not to try again, ms */
+	GString *record;		/* response body, when recording */
+};
+
+static void
+aur_batch_free(gpointer data)
+{
+	struct aur_batch *batch = data;
+
+	aur_parser_free(&batch->parser);
+	if (batch->record)
+		g_string_free(batch->record, TRUE);
+	curl_slist_free_all(batch->headers);
+	g_slist_free(batch->names);
+	g_free(batch->modified);
+	g_free(batch->etag);
+	g_free(batch->key);
+	g_free(batch->body);
+	g_free(batch->uri);
+	free(batch);
+}
+
+/** @brief identify a batch by its names, whatever their order */
+static char *
+aur_batch_key(struct aur_batch *batch)
+{
+	GSList *sorted = g_slist_sort(g_slist_copy(batch->names), (GCompareFunc) strcmp), *n;
+	GString *str = g_string_new(NULL);
+	char *key;
+
+	for (n = sorted; n; n = n->next) {
+		g_string_append(str, n->data);
+		g_string_append_c(str, '\n');
+	}
+	key = g_compute_checksum_for_string(G_CHECKSUM_SHA1, str->str, str->len);
+	g_string_free(str, TRUE);
+	g_slist_free(sorted);
+	return (key);
+}
+
+static size_t
+aur_header_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	struct aur_batch *batch = userdata;
+	size_t len = size * nmemb, skip = 0;
+	char **field = NULL;
+
+	if (len > 5 && !g_ascii_strncasecmp(ptr, "ETag:", 5)) {
+		field = &batch->etag;
+		skip = 5;
+	} else if (len > 14 && !g_ascii_strncasecmp(ptr, "Last-Modified:", 14)) {
+		field = &batch->modified;
+		skip = 14;
+	} else if (len > 12 && !g_ascii_strncasecmp(ptr, "Retry-After:", 12)) {
+		char *value = g_strstrip(g_strndup(ptr + 12, len - 12)), *end;
+		time_t when;
+
+		/* either delay-seconds or an HTTP-date */
+		if ((batch->after = strtol(value, &end, 10)) < 0 || *end) {
+			when = curl_getdate(value, NULL);
+			batch->after = when > 0 ? MAX(when - time(NULL), 0) : 0;
+		}
+		g_free(value);
+	}
+	if (field) {
+		g_free(*field);
+		*field = g_strstrip(g_strndup(ptr + skip, len - skip));
+	}
+	return (len);
+}
+
+static size_t
+aur_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	struct aur_batch *batch = userdata;
+
+	if (batch->record)
+		g_string_append_len(batch->record, ptr, size * nmemb);
+	return (writedata_callback(ptr, size, nmemb, &batch->parser));
+}
+
+/** @brief the file holding the recorded response to a batch */
+static char *
+aur_record_file(const char *dir, struct aur_batch *batch)
+{
+	char *name = g_strdup_printf("%s.json", batch->key), *file;
+
+	file = g_build_filename(dir, name, NULL);
+	g_free(name);
+	return (file);
+}
+
+/** @brief record the response to a batch for --replay */
+static void
+aur_record_save(struct aur_batch *batch)
+{
+	GError *error = NULL;
+	char *file;
+
+	if (g_mkdir_with_parents(options.record, 0755)) {
+		EPRINTF("Could not create %s: %s\n", options.record, strerror(errno));
+		return;
+	}
+	file = aur_record_file(options.record, batch);
+	if (!g_file_set_contents(file, batch->record->str, batch->record->len, &error)) {
+		EPRINTF("Could not record %s: %s\n", file, error->message);
+		g_error_free(error);
+	}
+	g_free(file);
+}
+
+/** @brief start a request
+  *
+  * Any encoding of the response that libcurl can decode is accepted.  When the
+  * AUR cache holds the results of all names of the batch along with the ETag
+  * or Last-Modified of the response they came from, the request is made
+  * conditional, so that the AUR can answer that nothing changed.
+  */
+static void
+aur_batch_start(CURLM *multi, CURL *curl, struct aur_batch *batch)
+{
+	struct json_object *prev, *obj;
+
+	aur_parser_init(&batch->parser);
+	curl_easy_setopt(curl, CURLOPT_URL, batch->uri);
+	curl_slist_free_all(batch->headers);
+	batch->headers = NULL;
+	if (batch->body) {
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long) strlen(batch->body));
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, batch->body);
+		/* do not wait for a 100 Continue response */
+		batch->headers = curl_slist_append(batch->headers, "Expect:");
+	} else
+		curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+	if (batch->key && (prev = aur_cache_validators(batch->key, batch->names))) {
+		char *header;
+
+		if ((obj = json_object_object_get(prev, "etag"))) {
+			header = g_strdup_printf("If-None-Match: %s", json_object_get_string(obj));
+			batch->headers = curl_slist_append(batch->headers, header);
+			g_free(header);
+		}
+		if ((obj = json_object_object_get(prev, "modified"))) {
+			header = g_strdup_printf("If-Modified-Since: %s", json_object_get_string(obj));
+			batch->headers = curl_slist_append(batch->headers, header);
+			g_free(header);
+		}
+	}
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, batch->headers);
+	g_free(batch->etag);
+	g_free(batch->modified);
+	batch->etag = batch->modified = NULL;
+	batch->retry = batch->busy = FALSE;
+	batch->after = 0;
+	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, aur_header_callback);
+	curl_easy_setopt(curl, CURLOPT_HEADERDATA, batch);
+	curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, (long) AUR_CONNECT_TIMEOUT);
+	/* give up on a transfer that stalls, however long it may take */
+	curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+	curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long) AUR_LOW_SPEED_TIME);
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, batch);
+	if (options.record) {
+		if (batch->record)
+			g_string_truncate(batch->record, 0);
+		else
+			batch->record = g_string_new(NULL);
+	}
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, batch);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, aur_write_callback);
+	/* prefer multiplexing over an existing HTTP/2 connection to opening a
+	   new connection */
+	curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+	curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+	curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+	DPRINTF(1, "Lookup up in AUR:\n%s%s%s\n", batch->uri, batch->body ? "\n" : "", batch->body ? : "");
+	curl_multi_add_handle(multi, curl);
+}
+
+/** @brief whether a failed request may succeed when tried again
+  *
+  * The AUR being overloaded (429, 503) or unavailable for a while (408, 500,
+  * 502, 504), and connections that fail, time out or break, are transient.
+  * Anything else, such as a response that does not parse, is not.
+  */
+static gboolean
+aur_retriable(CURLcode res, long code)
+{
+	switch (res) {
+	case CURLE_HTTP_RETURNED_ERROR:
+		return (code == 408 || code == 429 || code == 500 || code == 502 || code == 503
+			|| code == 504);
+	case CURLE_COULDNT_RESOLVE_HOST:
+	case CURLE_COULDNT_CONNECT:
+	case CURLE_OPERATION_TIMEDOUT:
+	case CURLE_SSL_CONNECT_ERROR:
+	case CURLE_SEND_ERROR:
+	case CURLE_RECV_ERROR:
+	case CURLE_GOT_NOTHING:
+	case CURLE_PARTIAL_FILE:
+	case CURLE_HTTP2:
+	case CURLE_HTTP2_STREAM:
+		return (TRUE);
+	default:
+		return (FALSE);
+	}
+}
+
+/** @brief finish a request
+  *
+  * A request that failed in a way that might not fail again is marked for
+  * retry, and what the failure was is left for aur_fetch() to report when it
+  * gives up on the request.
+  */
+static int
+aur_batch_done(struct aur_batch *batch, CURL *curl, CURLcode res)
+{
+	long code = 0;
+	int err;
+
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+	if (res != CURLE_OK && batch->body
+	    && (code == 400 || code == 405 || code == 413 || code == 415 || code == 501)) {
+		DPRINTF(1, "AUR POST rejected: HTTP %ld\n", code);
+		batch->rejected = TRUE;
+		err = -1;
+	} else if (res != CURLE_OK && !batch->parser.err && aur_retriable(res, code)) {
+		DPRINTF(1, "AUR request failed: %s (HTTP %ld)\n", curl_easy_strerror(res), code);
+		batch->retry = TRUE;
+		batch->busy = (code == 429 || code == 503);
+		err = -1;
+	} else if (res != CURLE_OK) {
+		if (!batch->parser.err)
+			EPRINTF("CURL error: %s\n", curl_easy_strerror(res));
+		err = -1;
+	} else if (code == 304) {
+		/* nothing to parse: the cached results still hold */
+		DPRINTF(1, "AUR batch %s not modified\n", batch->key);
+		err = aur_cache_revalidate(batch->key, batch->names);
+	} else if (!(err = aur_parser_finish(&batch->parser))) {
+		if (batch->key && (batch->etag || batch->modified))
+			aur_cache_validated(batch->key, batch->etag, batch->modified);
+		if (batch->record)
+			aur_record_save(batch);
+	}
+	aur_parser_free(&batch->parser);
+	return (err);
+}
+
+/*
+ * The rate at which AUR requests are started is limited with a token bucket
+ * that holds up to a second worth of requests.  Whenever the AUR answers that
+ * it is overloaded, the rate is halved (or, when unlimited, limited to one
+ * round of parallel requests every two seconds); each request that succeeds
+ * raises it again by AUR_RATE_STEP, up to --rate.  This way a server that can
+ * take more is not held back for long, while one that cannot is backed off
+ * from quickly.
+ */
+struct aur_limiter {
+	double rate;			/* requests per second, or 0 for unlimited */
+	double tokens;			/* requests that may be started */
+	double last;			/* time tokens were last added, ms */
+};
+
+static void
+aur_limiter_init(struct aur_limiter *lim)
+{
+	lim->rate = MAX(options.rate, 0);
+	lim->tokens = MAX(lim->rate, 1);
+	lim->last = pac_now();
+}
+
+/** @brief take a token to start a request
+  * @return 0 when one was taken, otherwise how long to wait for one, in ms
+  */
+static double
+aur_limiter_take(struct aur_limiter *lim, double now)
+{
+	if (lim->rate <= 0)
+		return (0);
+	lim->tokens = MIN(lim->tokens + (now - lim->last) * lim->rate / 1000.0, MAX(lim->rate, 1));
+	lim->last = now;
+	if (lim->tokens < 1)
+		return ((1 - lim->tokens) * 1000.0 / lim->rate);
+	lim->tokens -= 1;
+	return (0);
+}
+
+/** @brief adapt the rate to the AUR answering or refusing a request */
+static void
+aur_limiter_adapt(struct aur_limiter *lim, gboolean busy)
+{
+	if (busy) {
+		lim->rate = lim->rate > 0 ? lim->rate / 2 : options.parallel / 2.0;
+		lim->rate = MAX(lim->rate, AUR_RATE_MIN);
+		lim->tokens = MIN(lim->tokens, 1);
+		DPRINTF(1, "AUR is busy: limiting to %g requests per second\n", lim->rate);
+	} else if (lim->rate > 0 && (options.rate <= 0 || lim->rate < options.rate)) {
+		lim->rate += AUR_RATE_STEP;
+		if (options.rate > 0)
+			lim->rate = MIN(lim->rate, options.rate);
+	}
+}
+
+/** @brief how long to wait before trying a failed request again, in ms
+  *
+  * Backs off exponentially with the number of attempts made, with jitter so
+  * that requests that failed together do not all come back together, but
+  * never sooner than the AUR asked with Retry-After.
+  */
+static double
+aur_backoff(struct aur_batch *batch)
+{
+	double delay = MIN((double) AUR_BACKOFF_BASE * (1 << MIN(batch->tries - 1, 16)), AUR_BACKOFF_MAX);
+
+	delay = delay / 2 + g_random_double() * delay / 2;
+	return (MAX(delay, batch->after * 1000.0));
+}
+
+/** @brief answer a set of AUR RPC requests with the responses recorded for
+  * them by --record, without any network access
+  */
+static int
+aur_replay(GPtrArray *batches)
+{
+	GError *error = NULL;
+	char *file, *data;
+	gsize len;
+	guint i;
+	int err = 0;
+
+	for (i = 0; i < batches->len; i++) {
+		struct aur_batch *batch = g_ptr_array_index(batches, i);
+
+		file = aur_record_file(options.replay, batch);
+		DPRINTF(1, "Replaying %s\n", file);
+		if (g_file_get_contents(file, &data, &len, &error)) {
+			aur_parser_init(&batch->parser);
+			if (!(batch->err = aur_parser_feed(&batch->parser, data, len)))
+				batch->err = aur_parser_finish(&batch->parser);
+			aur_parser_free(&batch->parser);
+			g_free(data);
+		} else {
+			EPRINTF("No recorded response: %s\n", error->message);
+			g_clear_error(&error);
+			batch->err = -1;
+		}
+		if (batch->err)
+			err = batch->err;
+		g_free(file);
+	}
+	return (err);
+}
+
+/** @brief perform a set of AUR RPC requests concurrently
+  * @param batches - array of struct aur_batch
+  *
+  * Runs up to options.parallel requests at a time over a single CURL multi
+  * handle, so that connections (and HTTP/2 multiplexing) are reused between
+  * requests.  Each response is parsed as soon as its transfer completes.
+  * Easy handles are recycled from completed to pending requests.  Requests are
+  * started no faster than the rate limiter allows, and those that fail in a
+  * transient way are tried again, up to options.retries times, after backing
+  * off; requests that succeeded keep their results either way.
+  */
+int
+aur_fetch(GPtrArray *batches)
+{
+	struct aur_limiter lim;
+	struct aur_batch **pending;
+	CURLM *multi;
+	CURL **curls, **idle;
+	guint npending, i, j;
+	int nhandles, nidle = 0, running, active = 0, err = 0;
+
+	if (!batches->len)
+		return (0);
+	/* lookup info using CURL and parse result with JSON */
+	if (options.dryrun) {
+		for (i = 0; i < batches->len; i++) {
+			struct aur_batch *batch = g_ptr_array_index(batches, i);
+
+			OPRINTF(1, "Would look up:\n%s%s%s\n", batch->uri, batch->body ? "\n" : "",
+				batch->body ? : "");
+		}
+		return (0);
+	}
+	if (options.replay)
+		return (aur_replay(batches));
+	for (i = 0; i < batches->len; i++)
+		((struct aur_batch *) g_ptr_array_index(batches, i))->err = -1;
+	if (!(multi = curl_multi_init())) {
+		EPRINTF("Could not get CURL multi handle.\n");
+		return (-1);
+	}
+	nhandles = MIN((guint) options.parallel, batches->len);
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long) nhandles);
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long) nhandles);
+	curls = calloc(nhandles, sizeof(*curls));
+	idle = calloc(nhandles, sizeof(*idle));
+	/* requests not started, or to be tried again, in order */
+	pending = calloc(batches->len, sizeof(*pending));
+	for (npending = 0; npending < batches->len; npending++)
+		pending[npending] = g_ptr_array_index(batches, npending);
+	for (i = 0; i < (guint) nhandles; i++) {
+		if (!(curls[i] = curl_easy_init())) {
+			EPRINTF("Could not get CURL easy handle.\n");
+			err = -1;
+			goto cleanup;
+		}
+		idle[nidle++] = curls[i];
+	}
+	aur_limiter_init(&lim);
+	while (active || npending) {
+		double now = pac_now(), wait = 1000, w;
+		CURLMcode mc;
+		CURLMsg *msg;
+		int left;
+
+		if (aur_deadline && now >= aur_deadline) {
+			EPRINTF("AUR requests timed out, %u unanswered\n", active + npending);
+			err = -1;
+			break;
+		}
+		if (aur_deadline)
+			wait = MIN(wait, aur_deadline - now);
+		/* start the first requests that are due, as far as handles and the
+		   rate limit allow */
+		for (i = 0; nidle && i < npending;) {
+			struct aur_batch *batch = pending[i];
+
+			if (batch->due > now) {
+				wait = MIN(wait, batch->due - now);
+				i++;
+				continue;
+			}
+			if ((w = aur_limiter_take(&lim, now)) > 0) {
+				wait = MIN(wait, w);
+				break;
+			}
+			for (j = i + 1; j < npending; j++)
+				pending[j - 1] = pending[j];
+			npending--;
+			batch->tries++;
+			aur_batch_start(multi, idle[--nidle], batch);
+			active++;
+		}
+		if ((mc = curl_multi_perform(multi, &running)) == CURLM_OK)
+			mc = curl_multi_poll(multi, NULL, 0, MAX((int) wait, 1), NULL);
+		if (mc != CURLM_OK) {
+			EPRINTF("CURL multi error: %s\n", curl_multi_strerror(mc));
+			err = -1;
+			break;
+		}
+		while ((msg = curl_multi_info_read(multi, &left))) {
+			struct aur_batch *batch = NULL;
+			CURL *curl = msg->easy_handle;
+
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+			curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **) &batch);
+			curl_multi_remove_handle(multi, curl);
+			idle[nidle++] = curl;
+			active--;
+			batch->err = aur_batch_done(batch, curl, msg->data.result);
+			if (batch->retry || !batch->err)
+				aur_limiter_adapt(&lim, batch->busy);
+			if (batch->retry && batch->tries <= options.retries) {
+				batch->due = pac_now() + aur_backoff(batch);
+				/* no use waiting for a retry past the deadline */
+				if (!aur_deadline || batch->due < aur_deadline) {
+					DPRINTF(1, "Retrying AUR request in %.0f ms\n", batch->due - pac_now());
+					pending[npending++] = batch;
+					continue;
+				}
+			}
+			if (batch->retry)
+				EPRINTF("AUR request failed after %d tries: %s\n", batch->tries,
+					curl_easy_strerror(msg->data.result));
+			if (batch->err)
+				err = batch->err;
+		}
+	}
+      cleanup:
+	for (i = 0; i < (guint) nhandles; i++) {
+		if (curls[i]) {
+			curl_multi_remove_handle(multi, curls[i]);
+			curl_easy_cleanup(curls[i]);
+		}
+	}
+	free(pending);
+	free(idle);
+	free(curls);
+	curl_multi_cleanup(multi);
+	return (err);
+}
+
+/* a name and its request argument */
+struct aur_arg {
+	const char *name;
+	char *arg;
+	size_t len;
+};
+
+/* sort the arguments of AUR requests longest first */
+static int
+aur_arg_cmp(const void *a, const void *b)
+{
+	const struct aur_arg *arg1 = a, *arg2 = b;
+
+	if (arg1->len != arg2->len)
+		return (arg1->len > arg2->len ? -1 : 1);
+	return (strcmp(arg1->arg, arg2->arg));
+}
+
+/** @brief pack names into GET requests, as few as possible
+  *
+  * Packing the names into request URIs no longer than AUR_MAXLEN is bin
+  * packing: the names are packed first fit, longest first, which comes within
+  * a request or so of the fewest possible, and in practice (with names much
+  * shorter than a request) meets the lower bound of their total length over
+  * the room in a request.
+  */
+static void
+aur_batches_get(GSList *alist, GPtrArray *batches)
+{
+	guint count = g_slist_length(alist), nbatches = 0, i, j;
+	struct aur_arg *args = calloc(count + 1, sizeof(*args));
+	struct aur_batch **bins = calloc(count + 1, sizeof(*bins));
+	GString **uris = calloc(count + 1, sizeof(*uris));
+	size_t prefix, total = 0;
+	GSList *a;
+
+	for (i = 0, a = alist; a; a = a->next, i++) {
+		char *name = g_uri_escape_string(a->data, NULL, FALSE);
+
+		args[i].name = a->data;
+		args[i].arg = g_strconcat("&arg[]=", name, NULL);
+		args[i].len = strlen(args[i].arg);
+		g_free(name);
+	}
+	qsort(args, count, sizeof(*args), aur_arg_cmp);
+	prefix = strlen(options.url) + strlen("?v=5&type=info");
+	for (i = 0; i < count; i++) {
+		total += args[i].len;
+		for (j = 0; j < nbatches; j++)
+			if (uris[j]->len + args[i].len <= AUR_MAXLEN)
+				break;
+		if (j == nbatches) {
+			bins[j] = calloc(1, sizeof(*bins[j]));
+			uris[j] = g_string_new(options.url);
+			g_string_append(uris[j], "?v=5&type=info");
+			nbatches++;
+		}
+		g_string_append(uris[j], args[i].arg);
+		bins[j]->names = g_slist_prepend(bins[j]->names, (gpointer) args[i].name);
+		g_free(args[i].arg);
+	}
+	DPRINTF(1, "AUR lookup: %u names in %u GET requests (at least %zu)\n", count, nbatches,
+		(total + (AUR_MAXLEN - prefix) - 1) / (AUR_MAXLEN - prefix));
+	for (j = 0; j < nbatches; j++) {
+		bins[j]->uri = g_string_free(uris[j], FALSE);
+		g_ptr_array_add(batches, bins[j]);
+	}
+	free(uris);
+	free(bins);
+	free(args);
+}
+
+/** @brief split names evenly into POST requests of at most options.batch names
+  *
+  * The form encoded body of a POST request has no length limit of its own, so
+  * the number of requests is set by the number of names that the RPC endpoint
+  * accepts in one request.
+  */
+static void
+aur_batches_post(GSList *alist, GPtrArray *batches)
+{
+	guint count = g_slist_length(alist), nbatches, n, i;
+	GSList *a = alist;
+
+	if (!count)
+		return;
+	nbatches = (count + options.batch - 1) / options.batch;
+	for (n = 0; n < nbatches; n++) {
+		struct aur_batch *batch = calloc(1, sizeof(*batch));
+		GString *body = g_string_new("v=5&type=info");
+		/* the first count % nbatches requests take one name more */
+		guint per = count / nbatches + (n < count % nbatches);
+
+		for (i = 0; i < per; i++, a = a->next) {
+			char *name = g_uri_escape_string(a->data, NULL, FALSE);
+
+			g_string_append_printf(body, "&arg[]=%s", name);
+			g_free(name);
+			batch->names = g_slist_prepend(batch->names, a->data);
+		}
+		batch->uri = g_strdup(options.url);
+		batch->body = g_string_free(body, FALSE);
+		g_ptr_array_add(batches, batch);
+	}
+	DPRINTF(1, "AUR lookup: %u names in %u POST requests\n", count, nbatches);
+}
+
+/** @brief set names aside that the AUR could not be asked about */
+static void
+aur_set_aside(GSList *alist)
+{
+	GSList *n;
+
+	if (!aur_failed)
+		aur_failed = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (n = alist; n; n = n->next)
+		g_hash_table_add(aur_failed, g_strdup(n->data));
+}
+
+/** @brief look up names in the AUR
+  * @param alist - the names to look up, each once
+  *
+  * With --method=post (the default), should the RPC endpoint reject POST
+  * requests, the names are looked up again with GET requests, and so are all
+  * further lookups.
+  */
+int
+aur_lookup(GSList *alist)
+{
+	GPtrArray *batches = g_ptr_array_new_with_free_func(aur_batch_free);
+	GSList *rlist = NULL;
+	guint i, failed = 0;
+	int err = 0, ferr, ok = 0;
+
+	if (options.method == MethodPost)
+		aur_batches_post(alist, batches);
+	else
+		aur_batches_get(alist, batches);
+	for (i = 0; (options.ttl > 0 || options.record || options.replay) && i < batches->len; i++) {
+		struct aur_batch *batch = g_ptr_array_index(batches, i);
+
+		batch->key = aur_batch_key(batch);
+	}
+	ferr = aur_fetch(batches);
+	for (i = 0; i < batches->len; i++) {
+		struct aur_batch *batch = g_ptr_array_index(batches, i);
+
+		if (batch->rejected)
+			rlist = g_slist_concat(rlist, g_slist_copy(batch->names));
+		else if (batch->err) {
+			err = batch->err;
+			aur_set_aside(batch->names);
+			failed += g_slist_length(batch->names);
+		} else
+			ok++;
+	}
+	/* failed before any request completed */
+	if (ferr && !err && !rlist)
+		err = ferr;
+	if (err && ok) {
+		/* keep what was found: the names that could not be looked up are
+		   set aside instead of giving up on the AUR altogether */
+		EPRINTF("Could not look up %u names in the AUR\n", failed);
+		err = 0;
+	}
+	if (rlist) {
+		DPRINTF(1, "AUR RPC rejects POST: using GET\n");
+		options.method = MethodGet;
+		if (aur_lookup(rlist))
+			err = -1;
+		g_slist_free(rlist);
+	}
+	g_ptr_array_free(batches, TRUE);
+	return (err);
+}
+
+/*
+ * The AUR query planner collects the names to look up in the AUR, each once,
+ * however many roots or databases need it.  Split packages of a package base
+ * are looked up each by name: the current PKGBUILD of a package base need no
+ * longer build every package once built from it, so the AUR having one of
+ * them says nothing about the others.
+ */
+
+struct aur_plan {
+	struct idset queued;		/* ids of the names queued */
+	GSList *names;			/* names to look up, last queued first */
+};
+
+static void
+aur_plan_init(struct aur_plan *plan)
+{
+	memset(plan, 0, sizeof(*plan));
+}
+
+/** @brief queue a name for AUR lookup, once */
+static void
+aur_plan_add(struct aur_plan *plan, const char *name)
+{
+	uint32_t id = strtab_intern(&names, name);
+
+	if (idset_contains(&plan->queued, id))
+		return;
+	idset_add(&plan->queued, id);
+	DPRINTF(1, "Adding to AUR list: %s\n", name);
+	plan->names = g_slist_prepend(plan->names, strdup(name));
+}
+
+/** @brief take the names to look up, in the order queued */
+static GSList *
+aur_plan_names(struct aur_plan *plan)
+{
+	GSList *alist = g_slist_reverse(plan->names);
+
+	plan->names = NULL;
+	return (alist);
+}
+
+static void
+aur_plan_clear(struct aur_plan *plan)
+{
+	idset_clear(&plan->queued);
+	g_slist_free_full(plan->names, free);
+	memset(plan, 0, sizeof(*plan));
+}
+
+/** @} */
+
+/** @section AUR Metadata Dump
+  * @{ */
+
+/*
+ * The AUR publishes its complete package metadata as a gzipped JSON array of
+ * package objects with the same members as RPC results.  The dump is
+ * decompressed and parsed as it is read (from a file or a URL), so that the
+ * whole of it never needs to be held in memory.  Only packages with names
+ * that would otherwise have been looked up with the RPC are kept, unless all
+ * packages are requested.
+ */
+
+#define AUR_DUMP_BUFSIZ		(64 * 1024)
+
+struct aur_dump {
+	const char *source;		/* file name or URL */
+	z_stream zs;			/* inflate state */
+	gboolean compressed;		/* data is gzip compressed */
+	gboolean started;		/* first data has been seen */
+	struct aur_parser parser;	/* dump parser */
+	int err;
+};
+
+static int
+aur_dump_feed(struct aur_dump *dump, const char *data, size_t len)
+{
+	unsigned char out[AUR_DUMP_BUFSIZ];
+	int ret;
+
+	if (dump->err)
+		return (dump->err);
+	if (!dump->started && len) {
+		dump->started = TRUE;
+		dump->compressed = (len >= 2 && (unsigned char) data[0] == 0x1f
+				    && (unsigned char) data[1] == 0x8b);
+		if (dump->compressed && inflateInit2(&dump->zs, 15 + 32) != Z_OK) {
+			EPRINTF("Could not initialize zlib: %s\n", dump->zs.msg ? : "unknown error");
+			return ((dump->err = -1));
+		}
+	}
+	if (!dump->compressed)
+		return ((dump->err = aur_parser_feed(&dump->parser, data, len)));
+	dump->zs.next_in = (unsigned char *) data;
+	dump->zs.avail_in = len;
+	do {
+		dump->zs.next_out = out;
+		dump->zs.avail_out = sizeof(out);
+		ret = inflate(&dump->zs, Z_NO_FLUSH);
+		if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+			EPRINTF("Could not decompress %s: %s\n", dump->source, dump->zs.msg ? : "unknown error");
+			return ((dump->err = -1));
+		}
+		if (aur_parser_feed(&dump->parser, (char *) out, sizeof(out) - dump->zs.avail_out))
+			return ((dump->err = -1));
+		if (ret == Z_STREAM_END) {
+			/* concatenated gzip members */
+			if (inflateReset(&dump->zs) != Z_OK)
+				return ((dump->err = -1));
+		} else if (ret == Z_BUF_ERROR)
+			break;
+	} while (dump->zs.avail_in || !dump->zs.avail_out);
+	return (0);
+}
+
+static size_t
+aur_dump_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	if (aur_dump_feed(userdata, ptr, size * nmemb))
+		return (0);
+	return (size * nmemb);
+}
+
+static int
+aur_dump_read(struct aur_dump *dump)
+{
+	char buf[AUR_DUMP_BUFSIZ];
+	ssize_t len;
+	int fd;
+
+	if ((fd = open(dump->source, O_RDONLY)) == -1) {
+		EPRINTF("Could not open %s: %s\n", dump->source, strerror(errno));
+		return (-1);
+	}
+	while ((len = read(fd, buf, sizeof(buf))) != 0) {
+		if (len == -1) {
+			if (errno == EINTR)
+				continue;
+			EPRINTF("Could not read %s: %s\n", dump->source, strerror(errno));
+			break;
+		}
+		if (aur_dump_feed(dump, buf, len))
+			break;
+	}
+	close(fd);
+	return (len ? -1 : 0);
+}
+
+static int
+aur_dump_fetch(struct aur_dump *dump)
+{
+	CURLcode res;
+	CURL *curl;
+
+	if (!(curl = curl_easy_init())) {
+		EPRINTF("Could not get CURL easy handle.\n");
+		return (-1);
+	}
+	curl_easy_setopt(curl, CURLOPT_URL, dump->source);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, dump);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, aur_dump_callback);
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+	if (aur_deadline)
+		curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long) MAX(aur_deadline - pac_now(), 1));
+	DPRINTF(1, "Fetching AUR dump:\n%s\n", dump->source);
+	res = curl_easy_perform(curl);
+	curl_easy_cleanup(curl);
+	if (res != CURLE_OK) {
+		if (!dump->err)
+			EPRINTF("CURL error: %s\n", curl_easy_strerror(res));
+		return (-1);
+	}
+	return (0);
+}
+
+/** @brief load the AUR database from an AUR metadata dump
+  * @param source - file name or URL of the dump
+  * @param alist - names of packages to keep, or NULL to keep all packages
+  */
+int
+aur_dump_load(const char *source, GSList *alist)
+{
+	struct aur_dump dump = { .source = source, };
+	GHashTable *want = NULL;
+	GSList *a;
+	int err;
+
+	if (options.dryrun) {
+		OPRINTF(1, "Would load AUR dump:\n%s\n", source);
+		return (0);
+	}
+	if (alist) {
+		want = g_hash_table_new(g_str_hash, g_str_equal);
+		for (a = alist; a; a = a->next)
+			g_hash_table_add(want, a->data);
+	}
+	aur_db_get();
+	aur_parser_init(&dump.parser);
+	dump.parser.pkgdepth = 2;	/* [ { ... } ] */
+	dump.parser.want = want;
+	if (strstr(source, "://"))
+		err = aur_dump_fetch(&dump);
+	else
+		err = aur_dump_read(&dump);
+	if (!err)
+		err = aur_parser_finish(&dump.parser);
+	if (!err)
+		DPRINTF(1, "Loaded %zd packages from AUR dump %s\n", dump.parser.count, source);
+	if (dump.compressed)
+		inflateEnd(&dump.zs);
+	aur_parser_free(&dump.parser);
+	if (want)
+		g_hash_table_destroy(want);
+	return (err);
+}
+
+/** @} */
+
+/** @section AUR Cache
+  * @{ */
+
+/*
+ * The AUR cache is a JSON file in the cache directory (one per AUR URL)
+ * containing an "entries" object that maps each name looked up in the AUR to
+ * the time that it was looked up and the RPC result for the name (or null when
+ * the AUR had no package of that name).  Entries younger than the TTL are used
+ * in place of an RPC lookup; only expired or never-seen names are fetched.
+ *
+ * It also contains a "batches" object that maps the key of each batch of
+ * names looked up to the ETag and Last-Modified of its response, with which
+ * the batch is looked up conditionally when it comes up again: when the AUR
+ * answers that the response has not changed, the cached results of the
+ * names, expired or not, are used as they are.
+ */
+
+struct json_object *aur_cache = NULL;
+
+static char *
+aur_cache_file(void)
+{
+	char *sum, *base, *file;
+
+	sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, options.url, -1);
+	base = g_strdup_printf("aur-%s.json", sum);
+	file = g_build_filename(options.cachedir, base, NULL);
+	g_free(base);
+	g_free(sum);
+	return (file);
+}
+
+static struct json_object *
+aur_cache_entries(void)
+{
+	struct json_object *entries;
+
+	if (!(entries = json_object_object_get(aur_cache, "entries"))
+	    || !json_object_is_type(entries, json_type_object)) {
+		entries = json_object_new_object();
+		json_object_object_add(aur_cache, "entries", entries);
+	}
+	return (entries);
+}
+
+void
+aur_cache_load(void)
+{
+	struct json_object *obj;
+	char *file;
+
+	if (aur_cache)
+		return;
+	if (options.ttl > 0 && options.cachedir) {
+		file = aur_cache_file();
+		DPRINTF(1, "Reading AUR cache %s\n", file);
+		if ((aur_cache = json_object_from_file(file))) {
+			if (!json_object_is_type(aur_cache, json_type_object)
+			    || !(obj = json_object_object_get(aur_cache, "version"))
+			    || json_object_get_int(obj) != 1
+			    || !(obj = json_object_object_get(aur_cache, "url"))
+			    || strcmp(json_object_get_string(obj), options.url)) {
+				EPRINTF("Ignoring invalid AUR cache %s\n", file);
+				json_object_put(aur_cache);
+				aur_cache = NULL;
+			}
+		}
+		g_free(file);
+	}
+	if (!aur_cache) {
+		aur_cache = json_object_new_object();
+		json_object_object_add(aur_cache, "version", json_object_new_int(1));
+		json_object_object_add(aur_cache, "url", json_object_new_string(options.url));
+	}
+	aur_cache_entries();
+}
+
+/** @brief satisfy lookups from the AUR cache
+  * @param alist - list of names to look up in the AUR
+  * @return list of names that must still be looked up
+  *
+  * Adds a package to the AUR database for each fresh cache entry that has a
+  * result and drops the name from the list.  Fresh entries without a result
+  * (the AUR had no such package) are simply dropped.  The names that are
+  * dropped are freed.
+  */
+GSList *
+aur_cache_filter(GSList *alist)
+{
+	struct json_object *entries, *entry, *obj;
+	time_t now = time(NULL);
+	GSList *a, *next, *rlist = NULL;
+	size_t hits = 0, misses = 0;
+
+	if (options.ttl <= 0)
+		return (alist);
+	aur_cache_load();
+	entries = aur_cache_entries();
+	for (a = alist; a; a = next) {
+		const char *name = a->data;
+
+		next = a->next;
+		if ((entry = json_object_object_get(entries, name))
+		    && (obj = json_object_object_get(entry, "time"))
+		    && now - (time_t) json_object_get_int64(obj) < options.ttl) {
+			if ((obj = json_object_object_get(entry, "result"))) {
+				aur_pkg_t *aur_pkg;
+
+				if (!dbhash_lookup(aur_db_get(), name))
+					if ((aur_pkg = aur_pkg_from_json(obj)))
+						aur_db_add(aur_pkg);
+			}
+			DPRINTF(1, "AUR cache hit: %s\n", name);
+			free(a->data);
+			a->next = NULL;
+			g_slist_free(a);
+			hits++;
+			continue;
+		}
+		DPRINTF(1, "AUR cache miss: %s\n", name);
+		a->next = rlist;
+		rlist = a;
+		misses++;
+	}
+	DPRINTF(1, "AUR cache: %zd hits, %zd misses\n", hits, misses);
+	return (g_slist_reverse(rlist));
+}
+
+static struct json_object *
+aur_cache_batches(void)
+{
+	struct json_object *batches;
+
+	if (!(batches = json_object_object_get(aur_cache, "batches"))
+	    || !json_object_is_type(batches, json_type_object)) {
+		batches = json_object_new_object();
+		json_object_object_add(aur_cache, "batches", batches);
+	}
+	return (batches);
+}
+
+/** @brief get the validators of the previous response to a batch of names
+  * @return NULL unless there are validators and results for all the names
+  */
+struct json_object *
+aur_cache_validators(const char *key, GSList *names)
+{
+	struct json_object *entries, *prev;
+	GSList *n;
+
+	if (!aur_cache || !(prev = json_object_object_get(aur_cache_batches(), key)))
+		return (NULL);
+	entries = aur_cache_entries();
+	for (n = names; n; n = n->next)
+		if (!json_object_object_get(entries, n->data))
+			return (NULL);
+	return (prev);
+}
+
+/** @brief record the validators of the response to a batch of names */
+void
+aur_cache_validated(const char *key, const char *etag, const char *modified)
+{
+	struct json_object *batch;
+
+	if (!aur_cache || options.dryrun)
+		return;
+	batch = json_object_new_object();
+	if (etag)
+		json_object_object_add(batch, "etag", json_object_new_string(etag));
+	if (modified)
+		json_object_object_add(batch, "modified", json_object_new_string(modified));
+	json_object_object_add(batch, "time", json_object_new_int64(time(NULL)));
+	json_object_object_add(aur_cache_batches(), key, batch);
+}
+
+/** @brief use the cached results of a batch that the AUR reports unchanged
+  * @return non-zero when a result is missing
+  */
+int
+aur_cache_revalidate(const char *key, GSList *names)
+{
+	struct json_object *entries, *entry, *obj;
+	struct dbhash *dbhash = aur_db_get();
+	GSList *n;
+
+	if (!aur_cache)
+		return (-1);
+	if ((obj = json_object_object_get(aur_cache_batches(), key)) && !options.dryrun)
+		json_object_object_add(obj, "time", json_object_new_int64(time(NULL)));
+	entries = aur_cache_entries();
+	for (n = names; n; n = n->next) {
+		aur_pkg_t *aur_pkg;
+
+		if (!(entry = json_object_object_get(entries, n->data)))
+			return (-1);
+		if ((obj = json_object_object_get(entry, "result")) && !dbhash_lookup(dbhash, n->data))
+			if ((aur_pkg = aur_pkg_from_json(obj)))
+				aur_db_add(aur_pkg);
+	}
+	return (0);
+}
+
+/** @brief record the results of AUR lookups in the AUR cache
+  * @param alist - list of names that were looked up in the AUR
+  */
+void
+aur_cache_update(GSList *alist)
+{
+	struct json_object *entries, *entry;
+	int64_t now = time(NULL);
+	GSList *a;
+
+	if (options.ttl <= 0 || options.dryrun)
+		return;
+	aur_cache_load();
+	entries = aur_cache_entries();
+	for (a = alist; a; a = a->next) {
+		const char *name = a->data;
+		aur_pkg_t *aur_pkg = NULL;
+
+		if (!aur_known(name))
+			continue;
+		if (aur_db)
+			aur_pkg = dbhash_lookup(aur_db, name);
+		entry = json_object_new_object();
+		json_object_object_add(entry, "time", json_object_new_int64(now));
+		json_object_object_add(entry, "result", aur_pkg ? aur_pkg_to_json(aur_pkg) : NULL);
+		json_object_object_add(entries, name, entry);
+	}
+}
+
+void
+aur_cache_save(void)
+{
+	struct json_object *batches;
+	GError *error = NULL;
+	const char *data;
+	char *file;
+
+	if (!aur_cache || options.ttl <= 0 || options.dryrun || !options.cachedir)
+		return;
+	if ((batches = json_object_object_get(aur_cache, "batches"))) {
+		/* forget batches that have not come up again for a while */
+		int64_t now = time(NULL);
+		GSList *old = NULL, *o;
+
+		json_object_object_foreach(batches, key, val) {
+			struct json_object *obj = json_object_object_get(val, "time");
+
+			if (!obj || now - json_object_get_int64(obj) > AUR_BATCH_MAXAGE)
+				old = g_slist_prepend(old, g_strdup(key));
+		}
+		for (o = old; o; o = o->next)
+			json_object_object_del(batches, o->data);
+		g_slist_free_full(old, g_free);
+	}
+	if (g_mkdir_with_parents(options.cachedir, 0755)) {
+		EPRINTF("Could not create %s: %s\n", options.cachedir, strerror(errno));
+		return;
+	}
+	file = aur_cache_file();
+	data = json_object_to_json_string_ext(aur_cache, JSON_C_TO_STRING_PLAIN);
+	DPRINTF(1, "Writing AUR cache %s\n", file);
+	if (!g_file_set_contents(file, data, -1, &error)) {
+		EPRINTF("Could not write %s: %s\n", file, error->message);
+		g_error_free(error);
+	}
+	g_free(file);
+}
+
+/** @} */
+
+/** @section Snapshot
+  * @{ */
+
+/*
+ * With --incremental, the state of each run is kept in a snapshot file in the
+ * cache directory (one per set of options affecting the findings):
+ *
+ *   "aur":   name -> "version" of each AUR package used (" orphan" appended
+ *            when it has no maintainer, " flagged" when flagged out of date)
+ *   "roots": root -> {
+ *      "dbs":          names of the databases, in order
+ *      "fingerprints": database -> size and modification time of its files
+ *      "aurnames":     names looked up in the AUR for the root
+ *      "findings":     "analysis\tdatabase" -> [name, output, ...], and
+ *                      "analysis" -> ["", output] for OUTDATED and ALTERNATE
+ *   }
+ *
+ * and, in a file of its own per root that is read only when the root is loaded,
+ * database -> name -> "version provides..." of each package.
+ *
+ * A root whose databases are the same and whose files have the same
+ * fingerprints as in the previous run is not loaded at all.  Its findings are
+ * those of the previous run, unless the AUR packages of the names that it
+ * looks up changed, in which case it is loaded after all.
+ *
+ * A name has changed when a package of that name, or providing that name, was
+ * added, removed or changed version in any database of the root, or when the
+ * AUR package of that name changed.  The checks of a package only look up its
+ * own name and the names that it provides or depends on, so the findings of a
+ * package none of whose names changed are reused from the previous run.  When
+ * no name changed, the findings of an analysis of a database are reused
+ * without visiting its packages at all.
+ */
+
+#define SNAP_VERSION	2		/* of the snapshot format */
+
+struct json_object *snap_prev = NULL;
+struct json_object *snap_next = NULL;
+struct idset snap_aur_changed = { NULL, };
+
+static alpm_list_t *pac_db_names(struct pacroot *root);
+
+/** @brief the options that affect the findings, as a string */
+static char *
+snap_key(void)
+{
+	GString *key = g_string_new(NULL);
+	GSList *r;
+
+	g_string_append_printf(key, "analyses=%lu output=%d debug=%d format=%d",
+			       options.analyses, options.output, options.debug, options.format);
+	g_string_append_printf(key, " aur=%s dump=%s all=%d custom=%s repos=%s",
+			       options.url ? : "", options.dump ? : "", options.dumpall,
+			       options.custom ? : "", options.repos ? : "");
+	for (r = options.roots; r; r = r->next) {
+		struct pacroot *root = r->data;
+
+		g_string_append_printf(key, " root=%s,%s,%s", root->root, root->dbpath, root->config);
+	}
+	return (g_string_free(key, FALSE));
+}
+
+static char *
+snap_file(const char *key)
+{
+	char *sum, *base, *file;
+
+	sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, key, -1);
+	base = g_strdup_printf("snapshot-%s.json", sum);
+	file = g_build_filename(options.cachedir, base, NULL);
+	g_free(base);
+	g_free(sum);
+	return (file);
+}
+
+/** @brief the file of the packages of a root, apart from the snapshot */
+static char *
+snap_root_file(struct pacroot *root)
+{
+	const char *key = json_object_get_string(json_object_object_get(snap_next, "key"));
+	char *rkey = g_strdup_printf("%s pkgs=%s", key, root->root), *file = snap_file(rkey);
+
+	g_free(rkey);
+	return (file);
+}
+
+/** @brief get (or create) a member object of a JSON object */
+static struct json_object *
+snap_object(struct json_object *obj, const char *name)
+{
+	struct json_object *member;
+
+	if (!(member = json_object_object_get(obj, name))
+	    || !json_object_is_type(member, json_type_object)) {
+		member = json_object_new_object();
+		json_object_object_add(obj, name, member);
+	}
+	return (member);
+}
+
+/** @brief read the snapshot of the previous run */
+void
+snap_load(void)
+{
+	struct json_object *obj;
+	char *key, *file;
+
+	if (!options.incremental || !options.cachedir)
+		return;
+	key = snap_key();
+	file = snap_file(key);
+	DPRINTF(1, "Reading snapshot %s\n", file);
+	if ((snap_prev = json_object_from_file(file))) {
+		if (!json_object_is_type(snap_prev, json_type_object)
+		    || !(obj = json_object_object_get(snap_prev, "version"))
+		    || json_object_get_int(obj) != SNAP_VERSION
+		    || !(obj = json_object_object_get(snap_prev, "key"))
+		    || strcmp(json_object_get_string(obj), key)) {
+			EPRINTF("Ignoring invalid snapshot %s\n", file);
+			json_object_put(snap_prev);
+			snap_prev = NULL;
+		}
+	}
+	g_free(file);
+	snap_next = json_object_new_object();
+	json_object_object_add(snap_next, "version", json_object_new_int(SNAP_VERSION));
+	json_object_object_add(snap_next, "key", json_object_new_string(key));
+	g_free(key);
+}
+
+/** @brief add a name and the names in a "version provides..." string */
+static void
+snap_changed(struct idset *changed, const char *name, const char *value)
+{
+	const char *p, *e;
+	char *prov;
+
+	idset_add(changed, strtab_intern(&names, name));
+	if (!value || !(p = strchr(value, ' ')))
+		return;
+	for (p++; *p; p = *e ? e + 1 : e) {
+		if (!(e = strchr(p, ' ')))
+			e = p + strlen(p);
+		prov = g_strndup(p, e - p);
+		idset_add(changed, strtab_intern(&names, prov));
+		g_free(prov);
+	}
+}
+
+/** @brief record an AUR package used under a name and whether it changed */
+static void
+snap_aur_pkg(struct json_object *prev, struct json_object *next, const char *name, aur_pkg_t *pkg)
+{
+	struct json_object *obj;
+	char *value = g_strdup_printf("%s%s%s", aur_pkg_get_version(pkg),
+				      pkg->maintainer ? "" : " orphan", pkg->outofdate ? " flagged" : "");
+
+	if (!(obj = json_object_object_get(prev, name)) || strcmp(json_object_get_string(obj), value))
+		idset_add(&snap_aur_changed, strtab_intern(&names, name));
+	json_object_object_add(next, name, json_object_new_string(value));
+	g_free(value);
+}
+
+/** @brief record the AUR packages used and which of them changed */
+void
+snap_aur(void)
+{
+	struct json_object *prev = NULL, *next;
+	GHashTableIter iter;
+	gpointer key;
+	alpm_list_t *p;
+
+	if (!snap_next)
+		return;
+	if (snap_prev)
+		prev = json_object_object_get(snap_prev, "aur");
+	next = snap_object(snap_next, "aur");
+	for (p = aur_db ? aur_db->pkgs : NULL; p; p = alpm_list_next(p))
+		snap_aur_pkg(prev, next, ((aur_pkg_t *) p->data)->name, p->data);
+	if (aur_failed) {
+		/* names not looked up differ from names not found */
+		g_hash_table_iter_init(&iter, aur_failed);
+		while (g_hash_table_iter_next(&iter, &key, NULL)) {
+			struct json_object *obj = json_object_object_get(prev, key);
+
+			if (!obj || strcmp(json_object_get_string(obj), "?"))
+				idset_add(&snap_aur_changed, strtab_intern(&names, key));
+			json_object_object_add(next, key, json_object_new_string("?"));
+		}
+	}
+	if (prev && json_object_is_type(prev, json_type_object)) {
+		json_object_object_foreach(prev, name, val) {
+			(void) val;
+			if (!json_object_object_get(next, name))
+				idset_add(&snap_aur_changed, strtab_intern(&names, name));
+		}
+	}
+}
+
+/** @brief identify the state of the files of a database
+  * @param sync - name of the sync database, or NULL for the local database
+  */
+static char *
+snap_fingerprint(struct pacroot *root, const char *sync)
+{
+	struct stat st;
+	char *path, *fp = NULL;
+
+	if (!sync)
+		path = g_build_filename(root->dbpath, "local", NULL);
+	else
+		path = g_strdup_printf("%s/sync/%s.db", root->dbpath, sync);
+	if (!stat(path, &st))
+		fp = g_strdup_printf("%jd.%09ld:%jd", (intmax_t) st.st_mtim.tv_sec,
+				     st.st_mtim.tv_nsec, (intmax_t) st.st_size);
+	g_free(path);
+	return (fp);
+}
+
+/** @brief whether the databases of a root are those of the previous run
+  *
+  * Only the names of the databases and the fingerprints of their files are
+  * compared, before anything is loaded.  Sets root->snapprev to the previous run
+  * of the root when they are the same.
+  */
+static gboolean
+snap_root_unchanged(struct pacroot *root)
+{
+	struct json_object *prev, *dbs, *fps, *obj;
+	alpm_list_t *list, *d;
+	gboolean same;
+	size_t i, n;
+
+	if (!snap_prev || !(obj = json_object_object_get(snap_prev, "roots"))
+	    || !(prev = json_object_object_get(obj, root->root)))
+		return (FALSE);
+	if (!(obj = json_object_object_get(prev, "aur")) || json_object_get_boolean(obj) != aur_enabled())
+		return (FALSE);
+	if (!(dbs = json_object_object_get(prev, "dbs")) || !json_object_is_type(dbs, json_type_array))
+		return (FALSE);
+	fps = json_object_object_get(prev, "fingerprints");
+	list = pac_db_names(root);
+	n = json_object_array_length(dbs);
+	same = n == alpm_list_count(list) + 1;
+	/* the local database first */
+	for (i = 0, d = list; same && i < n; i++) {
+		const char *sync = i ? d->data : NULL, *name = sync ? : "local";
+		char *fp = snap_fingerprint(root, sync);
+
+		same = !strcmp(json_object_get_string(json_object_array_get_idx(dbs, i)), name)
+		    && fp && (obj = json_object_object_get(fps, name)) && !strcmp(json_object_get_string(obj), fp);
+		g_free(fp);
+		if (sync)
+			d = alpm_list_next(d);
+	}
+	FREELIST(list);
+	if (same)
+		root->snapprev = prev;
+	return (same);
+}
+
+/** @brief whether the AUR changed for a root that was not loaded
+  *
+  * That is, whether the AUR became unavailable or available, or any of the
+  * AUR packages of the names that the root looks up changed.
+  */
+static gboolean
+snap_root_aur_changed(struct pacroot *root)
+{
+	struct json_object *obj;
+	size_t i, n;
+
+	if (!(obj = json_object_object_get(root->snapprev, "aur")) || json_object_get_boolean(obj) != aur_enabled())
+		return (TRUE);
+	if (!root->aurnames)
+		return (FALSE);
+	for (i = 0, n = json_object_array_length(root->aurnames); i < n; i++) {
+		obj = json_object_array_get_idx(root->aurnames, i);
+		if (idset_contains(&snap_aur_changed, strtab_find(&names, json_object_get_string(obj))))
+			return (TRUE);
+	}
+	return (FALSE);
+}
+
+/** @brief compare the databases of a root with the previous run
+  *
+  * Sets root->changed to the names that changed, and root->snapprev to the
+  * previous run of the root when its findings can be reused at all.  For a root
+  * that was not loaded, all but the findings are carried over as they were.
+  */
+void
+snap_root_begin(struct pacroot *root)
+{
+	struct json_object *prev = NULL, *next, *dbs, *fps, *pkgs, *obj, *prevall = NULL;
+	GString *value;
+	gboolean reuse = TRUE;
+	GSList *s;
+	size_t i;
+
+	if (!snap_next)
+		return;
+	if (snap_prev && (obj = json_object_object_get(snap_prev, "roots")))
+		prev = json_object_object_get(obj, root->root);
+	next = json_object_new_object();
+	json_object_object_add(snap_object(snap_next, "roots"), root->root, next);
+	root->snapnext = next;
+	if (root->skipped) {
+		/* the findings are replayed analysis by analysis */
+		json_object_object_foreach(prev, key, val)
+			if (strcmp(key, "findings"))
+				json_object_object_add(next, key, json_object_get(val));
+		DPRINTF(1, "Snapshot of %s: unchanged\n", root->root);
+		return;
+	}
+	if (root->aurnames)
+		json_object_object_add(next, "aurnames", json_object_get(root->aurnames));
+
+	/* the findings of other databases cannot be reused when databases are
+	   added, removed or reordered, or when the AUR becomes unavailable */
+	dbs = json_object_new_array();
+	for (s = root->slist; s; s = s->next)
+		json_object_array_add(dbs, json_object_new_string(((struct dbhash *) s->data)->name));
+	json_object_object_add(next, "dbs", dbs);
+	json_object_object_add(next, "aur", json_object_new_boolean(aur_enabled()));
+	if (!prev || !(obj = json_object_object_get(prev, "dbs"))
+	    || json_object_array_length(obj) != json_object_array_length(dbs))
+		reuse = FALSE;
+	for (i = 0; reuse && i < json_object_array_length(dbs); i++)
+		if (strcmp(json_object_get_string(json_object_array_get_idx(obj, i)),
+			   json_object_get_string(json_object_array_get_idx(dbs, i))))
+			reuse = FALSE;
+	if (reuse && (!(obj = json_object_object_get(prev, "aur"))
+		      || json_object_get_boolean(obj) != aur_enabled()))
+		reuse = FALSE;
+
+	fps = snap_object(next, "fingerprints");
+	pkgs = root->snappkgs = json_object_new_object();
+	if (reuse) {
+		char *file = snap_root_file(root);
+
+		DPRINTF(1, "Reading snapshot %s\n", file);
+		prevall = json_object_from_file(file);
+		g_free(file);
+	}
+	value = g_string_new(NULL);
+	for (s = root->slist; s; s = s->next) {
+		struct dbhash *dbhash = s->data;
+		struct json_object *prevpkgs = NULL, *dbpkgs;
+		char *fp = snap_fingerprint(root, s == root->slist ? NULL : dbhash->name);
+		alpm_list_t *p;
+
+		if (fp)
+			json_object_object_add(fps, dbhash->name, json_object_new_string(fp));
+		if (reuse) {
+			prevpkgs = json_object_object_get(prevall, dbhash->name);
+			if (prevpkgs && fp && (obj = json_object_object_get(json_object_object_get(prev, "fingerprints"), dbhash->name))
+			    && !strcmp(json_object_get_string(obj), fp)) {
+				/* unchanged files: no need to look at the packages */
+				json_object_object_add(pkgs, dbhash->name, json_object_get(prevpkgs));
+				g_free(fp);
+				continue;
+			}
+		}
+		g_free(fp);
+		dbpkgs = snap_object(pkgs, dbhash->name);
+		for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
+			const char *name = dbhash_pkg_get_name(dbhash, p->data);
+			alpm_list_t *d;
+
+			g_string_assign(value, dbhash_pkg_get_version(dbhash, p->data));
+			for (d = dbhash_pkg_get_provides(dbhash, p->data); d; d = alpm_list_next(d))
+				g_string_append_printf(value, " %s", ((alpm_depend_t *) d->data)->name);
+			if (prevpkgs && (!(obj = json_object_object_get(prevpkgs, name))
+					 || strcmp(json_object_get_string(obj), value->str))) {
+				snap_changed(&root->changed, name, value->str);
+				if (obj)
+					snap_changed(&root->changed, name, json_object_get_string(obj));
+			}
+			json_object_object_add(dbpkgs, name, json_object_new_string(value->str));
+		}
+		if (prevpkgs && json_object_is_type(prevpkgs, json_type_object)) {
+			json_object_object_foreach(prevpkgs, name, val) {
+				if (!dbhash_lookup(dbhash, name))
+					snap_changed(&root->changed, name, json_object_get_string(val));
+			}
+		} else
+			reuse = FALSE;
+	}
+	g_string_free(value, TRUE);
+	if (prevall)
+		json_object_put(prevall);
+	idset_union(&root->changed, &snap_aur_changed);
+	root->snapprev = reuse ? prev : NULL;
+	DPRINTF(1, "Snapshot of %s: %s\n", root->root, reuse ? "reusable" : "not reusable");
+}
+
+/** @brief whether any name was changed since the previous run */
+static gboolean
+snap_root_changed(struct pacroot *root)
+{
+	uint32_t word;
+
+	for (word = 0; word < root->changed.words; word++)
+		if (root->changed.bits[word])
+			return (TRUE);
+	return (FALSE);
+}
+
+/** @brief the previous findings of an analysis of a database, if reusable */
+static struct json_object *
+snap_section(struct pacroot *root, const char *section)
+{
+	struct json_object *obj;
+
+	if (!root->snapprev || !(obj = json_object_object_get(root->snapprev, "findings")))
+		return (NULL);
+	if (!(obj = json_object_object_get(obj, section)) || !json_object_is_type(obj, json_type_array))
+		return (NULL);
+	return (obj);
+}
+
+/** @brief whether all previous findings of an analysis of a database hold */
+static gboolean
+snap_section_reusable(struct pacroot *root, const char *section)
+{
+	return (root->snapnext && snap_section(root, section) && !snap_root_changed(root));
+}
+
+/** @brief reuse all previous findings of an analysis of a database
+  * @param into - where to append the findings, or NULL to report them
+  * @return TRUE when the findings were reused
+  */
+static gboolean
+snap_section_replay(struct pacroot *root, const char *section, GString *into)
+{
+	struct json_object *prev;
+	GString *out;
+	size_t i, n;
+
+	if (!snap_section_reusable(root, section))
+		return (FALSE);
+	prev = snap_section(root, section);
+	out = into ? : g_string_new(NULL);
+	for (i = 1, n = json_object_array_length(prev); i < n; i += 2) {
+		struct json_object *obj = json_object_array_get_idx(prev, i);
+
+		g_string_append_len(out, json_object_get_string(obj), json_object_get_string_len(obj));
+	}
+	if (!into) {
+		report_replay(out);
+		g_string_free(out, TRUE);
+	}
+	json_object_object_add(snap_object(root->snapnext, "findings"), section, json_object_get(prev));
+	return (TRUE);
+}
+
+/** @brief reuse the previous findings of an analysis of a root that was not
+  * loaded: those of the whole root, then those of each database in order
+  */
+static void
+snap_root_replay(struct pacroot *root, const char *analysis)
+{
+	struct json_object *dbs = json_object_object_get(root->snapprev, "dbs");
+	size_t i, n;
+
+	snap_section_replay(root, analysis, NULL);
+	for (i = 0, n = json_object_array_length(dbs); i < n; i++) {
+		char *section = g_strdup_printf("%s\t%s", analysis,
+						json_object_get_string(json_object_array_get_idx(dbs, i)));
+
+		snap_section_replay(root, section, NULL);
+		g_free(section);
+	}
+}
+
+/** @brief index the previous findings of an analysis of a database by name */
+static GHashTable *
+snap_section_index(struct pacroot *root, const char *section)
+{
+	struct json_object *prev;
+	GHashTable *index;
+	size_t i, n;
+
+	if (!(prev = snap_section(root, section)))
+		return (NULL);
+	index = g_hash_table_new(g_str_hash, g_str_equal);
+	for (i = 0, n = json_object_array_length(prev); i + 1 < n; i += 2)
+		g_hash_table_insert(index, (gpointer) json_object_get_string(json_object_array_get_idx(prev, i)),
+				    json_object_array_get_idx(prev, i + 1));
+	return (index);
+}
+
+/** @brief whether any name that the checks of a package look up changed */
+static gboolean
+snap_pkg_changed(struct pacroot *root, const struct pkgitem *item)
+{
+	alpm_list_t *d;
+
+	if (idset_contains(&root->changed, strtab_find(&names, item->name)))
+		return (TRUE);
+	for (d = item->provides; d; d = alpm_list_next(d))
+		if (idset_contains(&root->changed, strtab_find(&names, ((alpm_depend_t *) d->data)->name)))
+			return (TRUE);
+	for (d = item->depends; d; d = alpm_list_next(d))
+		if (idset_contains(&root->changed, strtab_find(&names, ((alpm_depend_t *) d->data)->name)))
+			return (TRUE);
+	return (FALSE);
+}
+
+/** @brief start recording the findings of an analysis of a database for the
+  * next run
+  */
+static struct json_object *
+snap_section_new(struct pacroot *root, const char *section)
+{
+	struct json_object *array = json_object_new_array();
+
+	json_object_object_add(snap_object(root->snapnext, "findings"), section, array);
+	return (array);
+}
+
+/** @brief record the captured findings of a package */
+static void
+snap_section_add(struct json_object *array, const char *name, const char *out, size_t len)
+{
+	if (!len)
+		return;
+	json_object_array_add(array, json_object_new_string(name));
+	json_object_array_add(array, json_object_new_string_len(out, len));
+}
+
+/** @brief write a snapshot file */
+static void
+snap_write(const char *file, struct json_object *obj)
+{
+	GError *error = NULL;
+	const char *data;
+
+	data = json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PLAIN);
+	DPRINTF(1, "Writing snapshot %s\n", file);
+	if (!g_file_set_contents(file, data, -1, &error)) {
+		EPRINTF("Could not write %s: %s\n", file, error->message);
+		g_error_free(error);
+	}
+}
+
+void
+snap_save(void)
+{
+	struct json_object *obj;
+	char *file;
+	GSList *r;
+
+	if (!snap_next || options.dryrun)
+		return;
+	if (g_mkdir_with_parents(options.cachedir, 0755)) {
+		EPRINTF("Could not create %s: %s\n", options.cachedir, strerror(errno));
+		return;
+	}
+	obj = json_object_object_get(snap_next, "key");
+	file = snap_file(json_object_get_string(obj));
+	snap_write(file, snap_next);
+	g_free(file);
+	/* the packages of roots that were not loaded are left as they were */
+	for (r = options.roots; r; r = r->next) {
+		struct pacroot *root = r->data;
+
+		if (!root->snappkgs)
+			continue;
+		file = snap_root_file(root);
+		snap_write(file, root->snappkgs);
+		g_free(file);
+	}
+}
+
+/** @} */
+
+/** @section Sync Database Reader
+  * @{ */
+
+#define PKGSTORE_CHUNK	(64 << 10)
+
+static struct pkgstore *
+pkgstore_new(void)
+{
+	struct pkgstore *store = calloc(1, sizeof(*store));
+
+	store->strings = g_string_chunk_new(PKGSTORE_CHUNK);
+	return (store);
+}
+
+static void
+pkgstore_free(struct pkgstore *store)
+{
+	if (!store)
+		return;
+	g_string_chunk_free(store->strings);
+	g_slist_free_full(store->chunks, free);
+	free(store);
+}
+
+/** @brief allocate zeroed memory that lives as long as the store */
+static void *
+pkgstore_alloc(struct pkgstore *store, size_t size)
+{
+	void *ptr;
+
+	size = (size + 7) & ~(size_t) 7;
+	if (size > store->avail) {
+		store->next = calloc(1, PKGSTORE_CHUNK);
+		store->chunks = g_slist_prepend(store->chunks, store->next);
+		store->avail = PKGSTORE_CHUNK;
+	}
+	ptr = store->next;
+	store->next += size;
+	store->avail -= size;
+	return (ptr);
+}
+
+/** @brief append to a list whose nodes live as long as the store */
+static void
+pkgstore_append(struct pkgstore *store, alpm_list_t **list, void *data)
+{
+	alpm_list_t *node = pkgstore_alloc(store, sizeof(*node));
+
+	node->data = data;
+	if (*list) {
+		/* the head keeps the tail in prev */
+		node->prev = (*list)->prev;
+		(*list)->prev->next = node;
+		(*list)->prev = node;
+	} else {
+		node->prev = node;
+		*list = node;
+	}
+}
+
+/** @brief parse a dependency string such as "name>=version"
+  * @param str - the string, which is modified
+  */
+static alpm_depend_t *
+pkgstore_depend(struct pkgstore *store, char *str)
+{
+	alpm_depend_t *dep = pkgstore_alloc(store, sizeof(*dep));
+	char *p;
+
+	if ((p = strstr(str, ": ")))
+		*p = '\0';	/* optional dependency description */
+	dep->mod = ALPM_DEP_MOD_ANY;
+	if ((p = strpbrk(str, "<>="))) {
+		switch (p[0]) {
+		case '=':
+			dep->mod = ALPM_DEP_MOD_EQ;
+			break;
+		case '<':
+			dep->mod = (p[1] == '=') ? ALPM_DEP_MOD_LE : ALPM_DEP_MOD_LT;
+			break;
+		case '>':
+			dep->mod = (p[1] == '=') ? ALPM_DEP_MOD_GE : ALPM_DEP_MOD_GT;
+			break;
+		}
+		dep->version = g_string_chunk_insert_const(store->strings, p + ((p[1] == '=') ? 2 : 1));
+		*p = '\0';
+	}
+	dep->name = g_string_chunk_insert_const(store->strings, str);
+	return (dep);
+}
+
+/** @brief parse the desc (or depends) file of a sync database package
+  * @param text - the file content, null terminated, which is modified
+  *
+  * Only the fields used by the analyses are kept; all others are skipped.
+  */
+static void
+pkgstore_parse(struct pkgstore *store, struct pkgrec *rec, char *text)
+{
+	const char **field = NULL;
+	alpm_list_t **list = NULL;
+	char *line, *save = NULL;
+
+	for (line = strtok_r(text, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+		size_t len = strlen(line);
+
+		if (len > 2 && line[0] == '%' && line[len - 1] == '%') {
+			field = NULL;
+			list = NULL;
+			if (!strcmp(line, "%NAME%"))
+				field = &rec->name;
+			else if (!strcmp(line, "%VERSION%"))
+				field = &rec->version;
+			else if (!strcmp(line, "%BASE%"))
+				field = &rec->base;
+			else if (!strcmp(line, "%PROVIDES%"))
+				list = &rec->provides;
+			else if (!strcmp(line, "%CONFLICTS%"))
+				list = &rec->conflicts;
+			else if (!strcmp(line, "%DEPENDS%"))
+				list = &rec->depends;
+			continue;
+		}
+		if (field) {
+			*field = g_string_chunk_insert_const(store->strings, line);
+			field = NULL;
+		} else if (list)
+			pkgstore_append(store, list, pkgstore_depend(store, line));
+	}
+}
+
+#ifdef HAVE_LIBARCHIVE
+/** @brief read the packages of a sync database archive directly
+  * @param dbhash - the database, whose pkgs and store are set
+  * @param path - the database file, compressed or not
+  * @return 0 on success, -1 on failure
+  *
+  * Reads the desc (and, for older databases, depends) entry of each package
+  * into a compact struct pkgrec, rather than having libalpm build a full
+  * alpm_pkg_t for each package.
+  */
+static int
+pac_read_syncdb(struct dbhash *dbhash, const char *path)
+{
+	struct pkgstore *store;
+	struct archive *a;
+	struct archive_entry *entry;
+	struct pkgrec *rec = NULL;
+	GString *dir = g_string_new(NULL);
+	GString *buf = g_string_sized_new(BUFSIZ);
+	alpm_list_t *pkgs = NULL;
+	int r;
+
+	a = archive_read_new();
+	archive_read_support_filter_all(a);
+	archive_read_support_format_all(a);
+	if (archive_read_open_filename(a, path, 128 << 10) != ARCHIVE_OK) {
+		EPRINTF("Could not open %s: %s\n", path, archive_error_string(a));
+		archive_read_free(a);
+		g_string_free(dir, TRUE);
+		g_string_free(buf, TRUE);
+		return (-1);
+	}
+	store = pkgstore_new();
+	while ((r = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
+		const char *pathname = archive_entry_pathname(entry);
+		const char *base = strrchr(pathname, '/');
+		la_ssize_t len;
+		size_t got;
+
+		if (!base || (strcmp(base, "/desc") && strcmp(base, "/depends"))) {
+			archive_read_data_skip(a);
+			continue;
+		}
+		/* entries of the same package directory are consecutive */
+		if (!rec || dir->len != (size_t) (base - pathname)
+		    || strncmp(dir->str, pathname, dir->len)) {
+			if (rec && rec->name && rec->version)
+				pkgstore_append(store, &pkgs, rec);
+			rec = pkgstore_alloc(store, sizeof(*rec));
+			g_string_assign(dir, pathname);
+			g_string_truncate(dir, base - pathname);
+		}
+		g_string_set_size(buf, archive_entry_size(entry));
+		for (got = 0; got < buf->len; got += len)
+			if ((len = archive_read_data(a, buf->str + got, buf->len - got)) <= 0)
+				break;
+		if (got < buf->len) {
+			r = ARCHIVE_FATAL;
+			break;
+		}
+		pkgstore_parse(store, rec, buf->str);
+	}
+	if (rec && rec->name && rec->version)
+		pkgstore_append(store, &pkgs, rec);
+	if (r != ARCHIVE_EOF)
+		EPRINTF("Could not read %s: %s\n", path, archive_error_string(a));
+	archive_read_free(a);
+	g_string_free(dir, TRUE);
+	g_string_free(buf, TRUE);
+	if (r != ARCHIVE_EOF) {
+		pkgstore_free(store);
+		return (-1);
+	}
+	dbhash->store = store;
+	dbhash->pkgs = pkgs;
+	return (0);
+}
+#endif				/* HAVE_LIBARCHIVE */
+
+/** @} */
+
+/** @section Analysis Driver
+  * @{ */
+
+static struct dbhash *
+pac_dbhash_new(alpm_db_t *db)
+{
+	struct dbhash *dbhash = calloc(1, sizeof(*dbhash));
+
+	dbhash->db = db;
+	dbhash->name = strdup(alpm_db_get_name(db));
+	dbhash->pkgs = alpm_db_get_pkgcache(db);
+	dbhash->refs = 1;
+	return (dbhash);
+}
+
+/** @brief identify the file content of a sync database
+  * @return "name:sha1" newly allocated, or NULL when the file cannot be read
+  */
+static char *
+pac_db_key(struct pacroot *root, const char *name)
+{
+	char *path, *key = NULL;
+	GChecksum *sum;
+	guchar buf[BUFSIZ];
+	size_t len;
+	FILE *f;
+
+	path = g_strdup_printf("%s/sync/%s.db", root->dbpath, name);
+	if ((f = fopen(path, "r"))) {
+		sum = g_checksum_new(G_CHECKSUM_SHA1);
+		while ((len = fread(buf, 1, sizeof(buf), f)))
+			g_checksum_update(sum, buf, len);
+		if (!ferror(f))
+			key = g_strdup_printf("%s:%s", name, g_checksum_get_string(sum));
+		g_checksum_free(sum);
+		fclose(f);
+	}
+	g_free(path);
+	return (key);
+}
+
+/** @brief the names of the sync databases of a root that are to be loaded, in
+  * order
+  */
+static alpm_list_t *
+pac_db_names(struct pacroot *root)
+{
+	alpm_list_t *list, *d, *names = NULL;
+	int select, local = repo_select("local");
+
+	/* Repositories that are only referenced are needed for their names:
+	   by the missing dependency and alternate analyses; when the local
+	   database is analyzed, to tell which local packages are foreign or
+	   outdated; and by the cross repository checks, which compare a
+	   repository with those following it. */
+	gboolean needed = (options.analyses & (PACANA_ANALYSIS_MISSING | PACANA_ANALYSIS_ALTERNATE))
+	    || (local > 0 && ((options.analyses & (PACANA_ANALYSIS_STRANDED | PACANA_ANALYSIS_OUTDATED))
+			      || aur_enabled()));
+	gboolean crossref = FALSE;
+
+	list = get_database_names(root->config);
+	for (d = list; d; d = alpm_list_next(d)) {
+		const char *name = d->data;
+
+		if ((select = repo_select(name)) < 0) {
+			DPRINTF(1, "ALPM database: %s (excluded)\n", name);
+			continue;
+		}
+		if (select == 0 && !needed && !crossref) {
+			DPRINTF(1, "ALPM database: %s (not needed)\n", name);
+			continue;
+		}
+		if (select > 0 && (options.analyses & (PACANA_ANALYSIS_SHADOW | PACANA_ANALYSIS_PROVIDES | PACANA_ANALYSIS_VCSCHECK)))
+			crossref = TRUE;
+		names = alpm_list_add(names, strdup(name));
+	}
+	FREELIST(list);
+	return (names);
+}
+
+/** @brief register and load the local and sync databases of a root
+  * @param root - the root whose databases to load
+  * @param shared - sync databases already loaded, by file content, or NULL
+  *
+  * Sets root->handle and root->slist, the list of struct dbhash with the
+  * local database first, not yet indexed.  A sync database whose file is
+  * identical to one in @shared is not registered again, but shared.
+  */
+static void
+pac_load(struct pacroot *root, GHashTable *shared)
+{
+	const char *version = alpm_version();
+
+	DPRINTF(1, "ALPM version: %s\n", version);
+
+	int caps = alpm_capabilities();
+
+	if (caps & ALPM_CAPABILITY_NLS)
+		DPRINTF(1, "ALPM capability NLS\n");
+	if (caps & ALPM_CAPABILITY_DOWNLOADER)
+		DPRINTF(1, "ALPM capability DOWNLOADER\n");
+	if (caps & ALPM_CAPABILITY_SIGNATURES)
+		DPRINTF(1, "ALPM capability SIGNATURES\n");
+
+	alpm_errno_t error = 0;
+	alpm_handle_t *handle = alpm_initialize(root->root, root->dbpath, &error);
+
+	if (!handle || error != 0) {
+		EPRINTF("Could not initialize ALPM for %s: %s\n", root->root, alpm_strerror(error));
+		exit(EXIT_FAILURE);
+	}
+	alpm_list_t *list;
+	alpm_list_t *d;
+
+	GSList *slist = NULL;
+	struct dbhash *dbhash;
+	int select;
+
+	dbhash = pac_dbhash_new(alpm_get_localdb(handle));
+	dbhash->select = repo_select(dbhash->name);
+	slist = g_slist_append(slist, dbhash);
+
+	list = pac_db_names(root);
+	for (d = list; d; d = alpm_list_next(d)) {
+		const char *name = d->data;
+		char *key;
+		alpm_db_t *db;
+
+		select = repo_select(name);
+		key = shared ? pac_db_key(root, name) : NULL;
+
+		if (key && (dbhash = g_hash_table_lookup(shared, key))) {
+			DPRINTF(1, "ALPM database: %s (shared)\n", name);
+			dbhash->refs++;
+			slist = g_slist_append(slist, dbhash);
+			g_free(key);
 			continue;
-		alpm_pkg_t *pkg2;
-		if ((pkg2 = g_hash_table_lookup(dbhash2->hash, name))) {
-			const char *name2 = alpm_pkg_get_name(pkg2);
-			const char *vers2 = alpm_pkg_get_version(pkg2);
-
-			WPRINTF("%s/%s %s masks %s/%s %s\n",
-					sync, name, vers, sync2, name2, vers2);
-			switch (alpm_pkg_vercmp(vers, vers2)) {
-			case -1:
-				WPRINTF("%s/%s %s out of date\n", sync, name, vers);
-				break;
-			case 0:
-				break;
-			case 1:
-				WPRINTF("%s/%s %s out of date\n", sync2, name2, vers2);
-				break;
+		}
+#ifdef HAVE_LIBARCHIVE
+		if (options.native) {
+			char *path = g_strdup_printf("%s/sync/%s.db", root->dbpath, name);
+
+			dbhash = calloc(1, sizeof(*dbhash));
+			dbhash->name = strdup(name);
+			dbhash->select = select;
+			dbhash->refs = 1;
+			if (!pac_read_syncdb(dbhash, path)) {
+				DPRINTF(1, "Native database: %s\n", name);
+				g_free(path);
+				slist = g_slist_append(slist, dbhash);
+				if (key)
+					g_hash_table_insert(shared, key, dbhash);
+				continue;
 			}
+			/* fall back to libalpm */
+			g_free(path);
+			free(dbhash->name);
+			free(dbhash);
+		}
+#endif
+		if (!(db = alpm_register_syncdb(handle, name, ALPM_SIG_DATABASE_OPTIONAL))) {
+			EPRINTF("Could not register database %s: %s\n", name, alpm_strerror(alpm_errno(handle)));
+			g_free(key);
+			continue;
 		}
+		DPRINTF(1, "ALPM database: %s\n", name);
+		dbhash = pac_dbhash_new(db);
+		dbhash->select = select;
+		slist = g_slist_append(slist, dbhash);
+		if (key)
+			g_hash_table_insert(shared, key, dbhash);
 	}
+	FREELIST(list);
+
+	root->handle = handle;
+	root->slist = slist;
 }
 
-gboolean
-find_depends(alpm_list_t *d, const char *name)
+/** @brief extract the package information that the checks use */
+static void
+pkgitem_init(struct pkgitem *item, struct dbhash *dbhash, void *pkg)
 {
-	for (; d; d = alpm_list_next(d)) {
-		alpm_depend_t *n = d->data;
+	item->pkg = pkg;
+	item->name = dbhash_pkg_get_name(dbhash, pkg);
+	item->version = dbhash_pkg_get_version(dbhash, pkg);
+	item->provides = dbhash_pkg_get_provides(dbhash, pkg);
+	item->conflicts = dbhash_pkg_get_conflicts(dbhash, pkg);
+	item->depends = dbhash_pkg_get_depends(dbhash, pkg);
+	item->vcs = vcs_package(dbhash, pkg);
+}
 
-		if (!strcmp(n->name, name))
-			return TRUE;
+/** @brief index the packages of each database of a root by name
+  *
+  * Each database, even when shared by several roots, is indexed once.  Also
+  * builds the set of all names provided by any database of the root.
+  */
+static void
+pac_index(struct pacroot *root)
+{
+	GSList *s;
+
+	for (s = root->slist; s; s = s->next) {
+		struct dbhash *dbhash = s->data;
+		size_t count = 0;
+
+		if (dbhash->indexed) {
+			idset_union(&root->provided, &dbhash->provided);
+			continue;
+		}
+		DPRINTF(1, "ALPM database: %s\n", dbhash->name);
+		alpm_list_t *p;
+
+		dbhash->sorted = calloc(alpm_list_count(dbhash->pkgs), sizeof(*dbhash->sorted));
+		dbhash->items = calloc(alpm_list_count(dbhash->pkgs), sizeof(*dbhash->items));
+		for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
+			void *pkg = p->data;
+			const char *name = dbhash_pkg_get_name(dbhash, pkg);
+			uint32_t id = strtab_intern(&names, name);
+
+			dbhash->sorted[count].name = name;
+			dbhash->sorted[count].pkg = pkg;
+			/* Local database package information is loaded lazily on
+			   first access: this loads it now so that the checks, which
+			   may run concurrently, only ever read it. */
+			pkgitem_init(&dbhash->items[count], dbhash, pkg);
+
+			DPRINTF(1, "ALPM package: %s/%s\n", dbhash->name, name);
+			nameidx_insert(&dbhash->index, id, pkg);
+			count++;
+
+			idset_add(&dbhash->provided, id);
+			dbhash_verkey_add(dbhash, dbhash_pkg_get_version(dbhash, pkg));
+			alpm_list_t *d;
+			for (d = dbhash_pkg_get_provides(dbhash, pkg); d; d = alpm_list_next(d)) {
+				alpm_depend_t *dep = d->data;
+				idset_add(&dbhash->provided, strtab_intern(&names, dep->name));
+				dbhash_verkey_add(dbhash, dep->version);
+			}
+		}
+		dbhash->nsorted = dbhash->nitems = count;
+		qsort(dbhash->sorted, count, sizeof(*dbhash->sorted), pkgname_cmp);
+		dbhash->indexed = TRUE;
+		idset_union(&root->provided, &dbhash->provided);
+		DPRINTF(1, "ALPM database: %s (%zd packages)\n", dbhash->name, count);
 	}
-	return FALSE;
 }
 
-gboolean
-vcs_package(alpm_pkg_t *pkg)
+typedef void (*check_func_t) (GSList *, const struct pkgitem *);
+
+#define PAC_JOB_MINPKGS	256
+
+/* databases checked by an analysis performed package by package */
+#define PAC_DB_LOCAL	(1 << 0)	/* the local database */
+#define PAC_DB_SYNC	(1 << 1)	/* all sync databases */
+#define PAC_DB_CUSTOM	(1 << 2)	/* custom sync databases only */
+
+/* An analysis, in report order: either performed package by package by the
+   fused pass of pac_foreach(), or on a root as a whole. */
+struct pac_analysis {
+	unsigned long analysis;		/* PACANA_ANALYSIS_* */
+	const char *name;		/* of its snapshot sections */
+	const char *title;		/* in the report */
+	int dbs;			/* PAC_DB_* checked */
+	gboolean aur;			/* requires AUR information */
+	check_func_t check;		/* check of a package */
+	void (*analyze) (GSList *, const char *);	/* analysis of a root */
+};
+
+static const struct pac_analysis pac_analyses[] = {
+	/* *INDENT-OFF* */
+	{ PACANA_ANALYSIS_SHADOW,	"shadow",	"SHADOW",	PAC_DB_SYNC,			FALSE,	check_shadow,		NULL			},
+	{ PACANA_ANALYSIS_PROVIDES,	"provides",	"PROVIDES",	PAC_DB_SYNC,			FALSE,	check_provides,		NULL			},
+	{ PACANA_ANALYSIS_VCSCHECK,	"vcscheck",	"VCSCHECK",	PAC_DB_SYNC,			FALSE,	check_vcscheck,		NULL			},
+	{ PACANA_ANALYSIS_OUTDATED,	"outdated",	"OUTDATED",	0,				FALSE,	NULL,			analyze_outdated	},
+	{ PACANA_ANALYSIS_ALTERNATE,	"alternate",	"ALTERNATE",	0,				FALSE,	NULL,			analyze_alternate	},
+	{ PACANA_ANALYSIS_STRANDED,	"stranded",	"STRANDED",	PAC_DB_LOCAL | PAC_DB_CUSTOM,	TRUE,	check_stranded,		NULL			},
+	{ PACANA_ANALYSIS_AURCHECK,	"aurcheck",	"AURCHECK",	PAC_DB_CUSTOM,			TRUE,	check_aurcheck,		NULL			},
+	{ PACANA_ANALYSIS_MISSING,	"missing",	"MISSING",	PAC_DB_LOCAL | PAC_DB_SYNC,	FALSE,	check_missing,		NULL			},
+	/* *INDENT-ON* */
+};
+
+#define PAC_NANALYSES	G_N_ELEMENTS(pac_analyses)
+
+/** @brief whether an analysis is selected and performed package by package */
+static inline gboolean
+pac_checked(const struct pac_analysis *an)
 {
-	char buf[5] = { 0, };
-	const char *vcss[] = { "git", "svn", "cvs", "bzr", NULL };
-	const char *name = alpm_pkg_get_name(pkg);
-	const char **vcs;
-	const char *s;
-	for (vcs = vcss; *vcs; vcs++) {
-		strcpy(buf, "-");
-		strcat(buf, *vcs);
-		if (!(s = strstr(name, buf)) || s != name + strlen(name) - 4) {
-//			alpm_db_t *db = alpm_pkg_get_db(pkg);
-//			const char *sync = alpm_db_get_name(db);
-//			DPRINTF(1, "%s/%s not named %s\n", sync, name, buf);
+	return ((options.analyses & an->analysis) && an->check && (!an->aur || aur_enabled()));
+}
+
+/* phases of an analysis run, timed for --timings */
+enum pac_phase {
+	PhaseSnapshot,			/* loading the snapshot of the previous run */
+	PhaseLoad,			/* loading the databases */
+	PhaseIndex,			/* indexing the databases */
+	PhaseAur,			/* looking up the AUR */
+	PhaseChecks,			/* the fused pass and analyses of roots */
+	PhaseReport,			/* writing out the findings */
+	PhaseSave,			/* saving the snapshot */
+	PhaseRelease,			/* releasing the databases */
+	PAC_NPHASES
+};
+
+static const char *pac_phase_names[PAC_NPHASES] = {
+	"snapshot", "load", "index", "aur", "checks", "report", "save", "release",
+};
+
+double pac_phases[PAC_NPHASES];		/* milliseconds spent in each phase */
+double pac_times[PAC_NANALYSES];	/* milliseconds spent on each analysis */
+
+/** @brief account the time since start to a phase
+  * @return the time now, to start the next phase with
+  */
+static double
+pac_phase(enum pac_phase phase, double start)
+{
+	double now = pac_now();
+
+	pac_phases[phase] += now - start;
+	return (now);
+}
+
+/** @brief write out the time spent in each phase and on each analysis
+  *
+  * The time spent on an analysis that is checked package by package is that
+  * of its checks alone, summed over all jobs, so that it does not depend on
+  * the other analyses performed along with it in the fused pass.
+  */
+static void
+pac_timings(double total)
+{
+	size_t p, a;
+
+	fprintf(stderr, "Timings (%d jobs):\n", options.jobs);
+	for (p = 0; p < PAC_NPHASES; p++) {
+		fprintf(stderr, "  %-16s %10.3f ms\n", pac_phase_names[p], pac_phases[p]);
+		if (p != PhaseChecks)
 			continue;
+		for (a = 0; a < PAC_NANALYSES; a++) {
+			const struct pac_analysis *an = &pac_analyses[a];
+
+			if (pac_checked(an) || ((options.analyses & an->analysis) && an->analyze))
+				fprintf(stderr, "    %-14s %10.3f ms\n", an->name, pac_times[a]);
 		}
-#if 0
-		/* why do binary packages have no makedepends? */
-		if (!find_depends(alpm_pkg_get_makedepends(pkg), *vcs)) {
-			alpm_db_t *db = alpm_pkg_get_db(pkg);
-			const char *sync = alpm_db_get_name(db);
-			DPRINTF(1, "%s/%s named %s but no makedepends %s\n", sync, name, buf, *vcs);
-			continue;
+	}
+	fprintf(stderr, "  %-16s %10.3f ms\n", "total", total);
+}
+
+struct pac_job {
+	GSList *s;			/* database list position */
+	const struct pac_analysis **checks;	/* analyses to check each package for */
+	int nchecks;
+	GHashTable **prev;		/* previous findings per analysis, when reusable */
+	const struct pkgitem *items;	/* first package of this job */
+	size_t count;			/* number of packages */
+	GString *outs[PAC_NANALYSES];	/* captured report output per analysis */
+	size_t *ends;			/* end of output per package and analysis, or NULL */
+	size_t reused;			/* packages whose previous findings were reused */
+	double times[PAC_NANALYSES];	/* milliseconds checking per analysis, for --timings */
+};
+
+struct pacroot *pac_root = NULL;	/* the root being analyzed */
+const char *pac_only = NULL;		/* only check packages of this name */
+
+static gpointer
+pac_job_run(gpointer data)
+{
+	struct pac_job *job = data;
+	GString *capture = report_capture;
+	size_t i;
+	int k;
+
+	for (i = 0; i < job->count; i++) {
+		const struct pkgitem *item = &job->items[i];
+		gboolean reuse = job->prev && !snap_pkg_changed(pac_root, item);
+
+		job->reused += reuse;
+		for (k = 0; k < job->nchecks; k++) {
+			struct json_object *obj;
+
+			if (!reuse) {
+				double start = options.timings ? pac_now() : 0;
+
+				report_capture = job->outs[k];
+				job->checks[k]->check(job->s, item);
+				if (options.timings)
+					job->times[k] += pac_now() - start;
+			} else if ((obj = g_hash_table_lookup(job->prev[k], item->name)))
+				g_string_append_len(job->outs[k], json_object_get_string(obj),
+						    json_object_get_string_len(obj));
+			if (job->ends)
+				job->ends[i * job->nchecks + k] = job->outs[k]->len;
 		}
-#endif
-		return TRUE;
 	}
-	return FALSE;
+	report_capture = capture;
+	vercmp_memo_free();
+	return (NULL);
 }
 
-void
-check_provides(GSList *s, alpm_pkg_t *pkg)
+/** @brief check the packages of a database for several analyses at once
+  * @param s - database list position of the database
+  * @param checks - the analyses to check each package for
+  * @param nchecks - number of analyses
+  * @param outputs - where to collect the report output of each analysis
+  *
+  * This is the fused pass: each package is visited once, from the flat array
+  * of package items of the database, and checked for each of the analyses in
+  * turn.  The report output of each analysis is captured separately, so that
+  * the caller can write it out analysis by analysis.
+  *
+  * With more than one job, the packages are split into contiguous runs that
+  * are checked by separate threads, and the output of each run is collected
+  * in run order once all threads complete, so that it is the same as when the
+  * packages are checked in order by a single thread.  The checks only perform
+  * lookups in indexes that are complete before any check runs.
+  *
+  * With --incremental, where the output of each package ends is recorded too,
+  * so that it can be saved in the snapshot, and packages that the snapshot
+  * shows to be unaffected by changes are not checked at all.
+  */
+static void
+pac_foreach(GSList *s, const struct pac_analysis **checks, int nchecks, GString **outputs)
 {
-	if (vcs_package(pkg))
-		return;
 	struct dbhash *dbhash = s->data;
-	const char *sync = dbhash->name;
-	const char *name = alpm_pkg_get_name(pkg);
-	const char *vers = alpm_pkg_get_version(pkg);
-	for (alpm_list_t *p = alpm_pkg_get_provides(pkg); p; p = alpm_list_next(p)) {
-		alpm_depend_t *d = p->data;
-		const char *namep = d->name ? : name;
-		const char *versp = d->version;
-		if (d->mod == ALPM_DEP_MOD_ANY) {
-			versp = vers;
-		} else if (d->mod == ALPM_DEP_MOD_EQ) {
-			versp = d->version;
+	struct pacroot *root = pac_root;
+	GHashTable *prev[PAC_NANALYSES] = { NULL, };
+	char *sections[PAC_NANALYSES] = { NULL, };
+	gboolean reusable = TRUE, indexed = TRUE;
+	size_t count, per, i, n, reused = 0;
+	struct pac_job *jobs;
+	GThread **threads;
+	int njobs = options.jobs, k;
+
+	/* repositories not selected with --repos are only referenced */
+	if (dbhash->select <= 0 || !nchecks)
+		return;
+	if (pac_only) {
+		GString *capture = report_capture;
+		struct pkgitem item;
+		void *pkg;
+
+		if (!(pkg = dbhash_lookup(dbhash, pac_only)))
+			return;
+		pkgitem_init(&item, dbhash, pkg);
+		for (k = 0; k < nchecks; k++) {
+			report_capture = outputs[k];
+			checks[k]->check(s, &item);
 		}
-		if (!find_depends(alpm_pkg_get_conflicts(pkg), namep))
-			continue;
-		for (GSList *n = s->next; n; n = n->next) {
-			struct dbhash *dbhash2 = n->data;
-			alpm_pkg_t *pkg2;
-			if ((pkg2 = g_hash_table_lookup(dbhash2->hash, namep))) {
-				const char *sync2 = dbhash2->name;
-				const char *name2 = alpm_pkg_get_name(pkg2);
-				const char *vers2 = alpm_pkg_get_version(pkg2);
+		report_capture = capture;
+		return;
+	}
+	if (root && root->snapnext) {
+		for (k = 0; k < nchecks; k++) {
+			sections[k] = g_strdup_printf("%s\t%s", checks[k]->name, dbhash->name);
+			reusable = reusable && snap_section_reusable(root, sections[k]);
+		}
+		for (k = 0; k < nchecks; k++) {
+			if (reusable) {
+				snap_section_replay(root, sections[k], outputs[k]);
+				DPRINTF(1, "Reused %s findings of %s\n", checks[k]->name, dbhash->name);
+			} else if (!(prev[k] = snap_section_index(root, sections[k])))
+				indexed = FALSE;
+		}
+		if (reusable) {
+			for (k = 0; k < nchecks; k++)
+				g_free(sections[k]);
+			return;
+		}
+	}
+	count = dbhash->nitems;
+	if (njobs > 1 && count / PAC_JOB_MINPKGS < (size_t) njobs)
+		njobs = MAX(count / PAC_JOB_MINPKGS, 1);
+	jobs = calloc(njobs, sizeof(*jobs));
+	threads = calloc(njobs, sizeof(*threads));
+	per = (count + njobs - 1) / njobs;
+	for (n = 0, i = 0; n < (size_t) njobs; n++, i += per) {
+		jobs[n].s = s;
+		jobs[n].checks = checks;
+		jobs[n].nchecks = nchecks;
+		/* packages are reused only when all their findings are known */
+		jobs[n].prev = sections[0] && indexed ? prev : NULL;
+		jobs[n].items = dbhash->items + MIN(i, count);
+		jobs[n].count = MIN(per, count - MIN(i, count));
+		for (k = 0; k < nchecks; k++)
+			jobs[n].outs[k] = g_string_new(NULL);
+		if (sections[0])
+			jobs[n].ends = calloc(jobs[n].count * nchecks + 1, sizeof(*jobs[n].ends));
+		if (njobs > 1)
+			threads[n] = g_thread_new(NAME, pac_job_run, &jobs[n]);
+		else
+			pac_job_run(&jobs[n]);
+	}
+	for (n = 0; n < (size_t) njobs; n++) {
+		if (njobs > 1)
+			g_thread_join(threads[n]);
+		for (k = 0; k < nchecks; k++) {
+			g_string_append_len(outputs[k], jobs[n].outs[k]->str, jobs[n].outs[k]->len);
+			pac_times[checks[k] - pac_analyses] += jobs[n].times[k];
+		}
+		reused += jobs[n].reused;
+	}
+	for (k = 0; k < nchecks && sections[k]; k++) {
+		struct json_object *array = snap_section_new(root, sections[k]);
 
-				WPRINTF("%s/%s %s provides %s/%s %s\n",
-						sync, name, versp, sync2, name2, vers2);
-				if (versp != vers)
-					OPRINTF(2, "%s/%s %s provides %s %s\n", sync, name, vers, name2, versp);
-				if (versp) {
-					switch (alpm_pkg_vercmp(versp, vers2)) {
-					case -1:
-						if (versp != vers) {
-							WPRINTF("%s/%s %s out of date\n", sync, name, vers);
-						} else {
-							WPRINTF("%s/%s %s could be out of date\n", sync, name, versp);
-							OPRINTF(3, "%s/%s %s => add provides=() version to PKGBUILD\n", sync, name, versp);
-						}
-						break;
-					case 0:
-						if (versp != vers) {
-							OPRINTF(1, "%s/%s %s up to date\n", sync, name, versp);
-						} else {
-							OPRINTF(1, "%s/%s %s appears up to date\n", sync, name, versp);
-							OPRINTF(3, "%s/%s %s => add provides=() version to PKGBUILD\n", sync, name, versp);
-						}
-						break;
-					case 1:
-						if (versp != vers) {
-							WPRINTF("%s/%s %s out of date\n", sync2, name2, vers2);
-						} else {
-							WPRINTF("%s/%s %s could be out of date\n", sync2, name2, vers2);
-							OPRINTF(3, "%s/%s %s => add provides=() version to PKGBUILD\n", sync, name, versp);
-						}
-						break;
-					}
-				}
+		for (n = 0; n < (size_t) njobs; n++) {
+			const char *out = jobs[n].outs[k]->str;
+			size_t start = 0, end;
+
+			for (i = 0; i < jobs[n].count; i++, start = end) {
+				end = jobs[n].ends[i * nchecks + k];
+				snap_section_add(array, jobs[n].items[i].name, out + start, end - start);
 			}
 		}
 	}
+	if (sections[0])
+		DPRINTF(1, "Reused findings of %zu of %zu packages of %s\n", reused, count, dbhash->name);
+	for (n = 0; n < (size_t) njobs; n++) {
+		for (k = 0; k < nchecks; k++)
+			g_string_free(jobs[n].outs[k], TRUE);
+		free(jobs[n].ends);
+	}
+	for (k = 0; k < nchecks; k++) {
+		if (prev[k])
+			g_hash_table_destroy(prev[k]);
+		g_free(sections[k]);
+	}
+	free(threads);
+	free(jobs);
 }
 
-void
-check_vcscheck(GSList *s, alpm_pkg_t *pkg)
+/** @brief select the analyses of the fused pass that check a database
+  * @param outputs - output per analysis in pac_analyses, NULL when not performed
+  * @param checks - the selected analyses
+  * @param outs - the output of each selected analysis
+  * @return the number of analyses selected
+  */
+static int
+pac_select(GSList *slist, GSList *s, GString **outputs, const struct pac_analysis **checks, GString **outs)
 {
-	if (!vcs_package(pkg))
-		return;
 	struct dbhash *dbhash = s->data;
-	const char *sync = dbhash->name;
-	const char *name = alpm_pkg_get_name(pkg);
-	const char *vers = alpm_pkg_get_version(pkg);
-	for (alpm_list_t *p = alpm_pkg_get_provides(pkg); p; p = alpm_list_next(p)) {
-		alpm_depend_t *d = p->data;
-		const char *namep = d->name ? : name;
-		const char *versp = d->version;
-		if (d->mod == ALPM_DEP_MOD_ANY) {
-			versp = vers;
-		} else if (d->mod == ALPM_DEP_MOD_EQ) {
-			versp = d->version;
+	int a, n = 0, dbs;
+
+	dbs = s == slist ? PAC_DB_LOCAL : dbhash->custom ? PAC_DB_SYNC | PAC_DB_CUSTOM : PAC_DB_SYNC;
+	for (a = 0; a < (int) PAC_NANALYSES; a++) {
+		if (!outputs[a] || !(pac_analyses[a].dbs & dbs))
+			continue;
+		checks[n] = &pac_analyses[a];
+		outs[n++] = outputs[a];
+	}
+	return (n);
+}
+
+/** @brief queue a name of a root for AUR lookup, and note it for the snapshot */
+static void
+pac_aur_add(struct pacroot *root, struct aur_plan *plan, struct idset *seen, const char *name)
+{
+	uint32_t id;
+
+	aur_plan_add(plan, name);
+	if (!root->aurnames || idset_contains(seen, (id = strtab_intern(&names, name))))
+		return;
+	idset_add(seen, id);
+	json_object_array_add(root->aurnames, json_object_new_string(name));
+}
+
+/** @brief collect the names of a root to look up in the AUR */
+static void
+pac_aur_names(struct pacroot *root, struct aur_plan *plan)
+{
+	GSList *slist = root->slist, *s;
+	struct idset seen = { NULL, };
+	struct dbhash *dbhash;
+
+	if (snap_next)
+		root->aurnames = json_object_new_array();
+
+	dbhash = slist->data;
+	alpm_list_t *p;
+
+	/* First, add to the list the names of all packages that exist in the
+	   local database that do not exist in any sync database. */
+	for (p = dbhash->select > 0 ? dbhash->pkgs : NULL; p; p = alpm_list_next(p)) {
+		alpm_pkg_t *pkg = p->data;
+		const char *name = alpm_pkg_get_name(pkg);
+		int found = 0;
+
+		/* skip local database */
+		for (s = slist->next; s; s = s->next) {
+			dbhash = s->data;
+			if (dbhash_lookup(dbhash, name)) {
+				found = 1;
+				break;
+			}
 		}
-		if (!find_depends(alpm_pkg_get_conflicts(pkg), namep))
+		if (!found)
+			pac_aur_add(root, plan, &seen, name);
+	}
+	/* Second, get a list of sync databases that are considered "custom".  */
+	/* skip local database */
+	for (s = slist->next; s; s = s->next) {
+		dbhash = s->data;
+		const char *sync = dbhash->name;
+
+		if (dbhash->select <= 0)
 			continue;
-		for (GSList *n = s->next; n; n = n->next) {
-			struct dbhash *dbhash2 = n->data;
-			alpm_pkg_t *pkg2;
-			if ((pkg2 = g_hash_table_lookup(dbhash2->hash, namep))) {
-				const char *sync2 = dbhash2->name;
-				const char *name2 = alpm_pkg_get_name(pkg2);
-				const char *vers2 = alpm_pkg_get_version(pkg2);
+		if (options.custom) {
+			switch (in_list(options.custom, sync)) {
+			case -1:	/* in list with ! prefixed */
+				dbhash->custom = FALSE;
+				continue;
+			case 0:	/* not in list */
+				dbhash->custom = FALSE;
+				continue;
+			case 1:	/* in list without ! prefixed */
+				dbhash->custom = TRUE;
+				break;
+			}
+		} else {
+			switch (in_list(ARCH_STANDARD_REPOS, sync)) {
+			case -1:	/* in list with ! prefixed */
+				dbhash->custom = TRUE;
+				break;
+			case 0:	/* not in list */
+				dbhash->custom = TRUE;
+				break;
+			case 1:	/* in list without ! prefixed */
+				dbhash->custom = FALSE;
+				continue;
+			}
+		}
+		DPRINTF(1, "Adding to AUR list: --> packages from %s <--\n", sync);
+		/* Third, add to the list the names of all packages from the
+		   custom databases. */
+		alpm_list_t *p;
 
-				WPRINTF("%s/%s %s vcs package for %s/%s %s\n",
-						sync, name, vers, sync2, name2, vers2);
-				if (versp != vers)
-					OPRINTF(2, "%s/%s %s provides %s %s\n", sync, name, vers, name2, versp);
-				if (versp) {
-					switch (alpm_pkg_vercmp(versp, vers2)) {
-					case -1:
-						if (versp != vers) {
-							WPRINTF("%s/%s %s out of date\n", sync, name, versp);
-						} else {
-							WPRINTF("%s/%s %s could be out of date\n", sync, name, versp);
-							OPRINTF(3, "%s/%s %s => add provides=() version to PKGBUILD\n", sync, name, versp);
-						}
-						break;
-					case 0:
-						if (versp != vers) {
-							OPRINTF(2, "%s/%s %s up to date\n", sync, name, versp);
-						} else {
-							OPRINTF(2, "%s/%s %s appears up to date\n", sync, name, versp);
-							OPRINTF(3, "%s/%s %s => add provides=() version to PKGBUILD\n", sync, name, versp);
-						}
-						break;
-					case 1:
-						if (versp != vers) {
-							WPRINTF("%s/%s %s out of date\n", sync2, name2, vers2);
-						} else {
-							WPRINTF("%s/%s %s could be out of date\n", sync2, name2, vers2);
-							OPRINTF(3, "%s/%s %s => add provides=() version to PKGBUILD\n", sync, name, versp);
-						}
-						break;
-					}
+		for (p = dbhash->pkgs; p; p = alpm_list_next(p))
+			pac_aur_add(root, plan, &seen, dbhash_pkg_get_name(dbhash, p->data));
+	}
+	if (options.analyses & PACANA_ANALYSIS_MISSING) {
+		/* Find all the missing dependencies (those in no sync
+		   database) and add them to the AUR list. */
+		for (s = slist; s; s = s->next) {
+			dbhash = s->data;
+			if (dbhash->select <= 0)
+				continue;
+			alpm_list_t *p;
+			for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
+				void *pkg = p->data;
+
+				alpm_list_t *d;
+				for (d = dbhash_pkg_get_depends(dbhash, pkg); d; d = alpm_list_next(d)) {
+					alpm_depend_t *dep = d->data;
+					const char *name = dep->name;
+
+					if (!idset_contains(&root->provided, strtab_find(&names, name)))
+						pac_aur_add(root, plan, &seen, name);
 				}
 			}
 		}
 	}
+	idset_clear(&seen);
+}
+
+/** @brief look up names in the AUR that the AUR cache cannot satisfy
+  * @return non-zero when the AUR could not be used at all
+  */
+static int
+pac_aur_fetch(GSList *alist)
+{
+	int err;
+
+	/* Names with fresh entries in the AUR cache need not be looked up
+	   again. */
+	alist = aur_cache_filter(alist);
+	if (!(err = aur_lookup(alist)))
+		aur_cache_update(alist);
+	else if (options.command == CommandDaemon) {
+		/* the daemon asks again on its next refresh */
+		aur_set_aside(alist);
+		err = 0;
+	}
+	g_slist_free_full(alist, freeit);
+	return (err);
+}
+
+/** @brief look up the names of all roots in the AUR */
+static void
+pac_aur_load(void)
+{
+	struct aur_plan plan;
+	GSList *alist, *r;
+	int err;
+
+	/* 
+	 * When the AUR is activated we need a list of all packages that exist
+	 * in the local database that do not exist in any sync database and the
+	 * list of all packages that exist in a "custom" sync database, and then
+	 * obtain information about them from the AUR.  Each name is looked up
+	 * once, however many roots need it.
+	 */
+	aur_plan_init(&plan);
+	for (r = options.roots; r; r = r->next) {
+		struct pacroot *root = r->data;
+		struct json_object *obj;
+		size_t i, n;
+
+		if (!root->skipped) {
+			pac_aur_names(root, &plan);
+			continue;
+		}
+		/* the same names as in the previous run */
+		if (!(obj = json_object_object_get(root->snapprev, "aurnames")))
+			continue;
+		root->aurnames = json_object_get(obj);
+		for (i = 0, n = json_object_array_length(obj); i < n; i++)
+			aur_plan_add(&plan, json_object_get_string(json_object_array_get_idx(obj, i)));
+	}
+	if (aur_failed)
+		g_hash_table_remove_all(aur_failed);
+
+	if (options.dump) {
+		/* The metadata dump replaces RPC lookups altogether. */
+		alist = aur_plan_names(&plan);
+		/* NULL would keep the whole dump, so read nothing when no name
+		   needs a lookup */
+		if ((alist || options.dumpall) &&
+		    aur_dump_load(options.dump, options.dumpall ? NULL : alist)) {
+			if (options.command == CommandDaemon) {
+				/* the daemon reads it again on its next refresh */
+				aur_set_aside(alist);
+				g_slist_free_full(alist, freeit);
+				aur_plan_clear(&plan);
+				return;
+			}
+			/* mark AUR as unusable */
+			free(options.dump);
+			options.dump = NULL;
+			free(options.url);
+			options.url = NULL;
+		}
+		g_slist_free_full(alist, freeit);
+	} else {
+		if ((err = pac_aur_fetch(aur_plan_names(&plan)))) {
+			/* mark AUR as unusable */
+			free(options.url);
+			options.url = NULL;
+		} else
+			aur_cache_save();
+	}
+	aur_plan_clear(&plan);
 }
 
-void
-check_stranded_local(GSList *slist, alpm_pkg_t *pkg)
+/** @brief perform the selected analyses on one root */
+static void
+pac_analyze_root(struct pacroot *root)
 {
-	struct dbhash *dbhash = slist->data;
-	const char *sync = dbhash->name;
-	const char *name = alpm_pkg_get_name(pkg);
-	const char *vers = alpm_pkg_get_version(pkg);
-	int found = 0;
-	GSList *s;
-
-	/* skip local database */
-	for (s = slist->next; s; s = s->next) {
-		dbhash = s->data;
-		if (g_hash_table_lookup(dbhash->hash, name)) {
-			found = 1;
-			break;
-		}
+	GSList *slist = root->slist, *s;
+	const struct pac_analysis *checks[PAC_NANALYSES];
+	GString *outputs[PAC_NANALYSES] = { NULL, }, *outs[PAC_NANALYSES];
+	double start = pac_now(), t;
+	size_t a;
+	int n;
+
+	provided = &root->provided;
+	pac_root = root;
+	snap_root_begin(root);
+	if (options.roots->next) {
+		finding_root = root->root;
+		OPRINTF(1, "Analyzing root %s:\n\n", root->root);
 	}
-	if (!found) {
-		/* Package from local database not found in any other sync database. This 
-		   package, by definition is foreign.  Without checking the AUR, this
-		   package will be marked foreign.  When we can check the AUR and it
-		   exists in the AUR, this package is marked stranded.  When it does not
-		   exist in the AUR, it is marked as foreign. */
-		/* If the package exists in the AUR and the AUR package version is newer
-		   than that of the package, mark it as out of date. */
-
-		aur_pkg_t *pkg2;
-		struct dbhash *dbhash2 = aur_db;
-
-		if ((pkg2 = g_hash_table_lookup(dbhash2->hash, name))) {
-			const char *sync2 = dbhash2->name;
-			const char *name2 = aur_pkg_get_base(pkg2);
-			const char *vers2 = aur_pkg_get_version(pkg2);
-
-			WPRINTF("%s/%s %s divorced to %s/%s %s\n", sync, name, vers, sync2, name2, vers2);
+	for (a = 0; a < PAC_NANALYSES && !root->skipped; a++)
+		if (pac_checked(&pac_analyses[a]))
+			outputs[a] = g_string_new(NULL);
+	/* each package is visited once for all the analyses that check it */
+	for (s = root->skipped ? NULL : slist; s; s = s->next) {
+		n = pac_select(slist, s, outputs, checks, outs);
+		pac_foreach(s, checks, n, outs);
+	}
+	start = pac_phase(PhaseChecks, start);
+	for (a = 0; a < PAC_NANALYSES; a++) {
+		const struct pac_analysis *an = &pac_analyses[a];
 
-			switch (alpm_pkg_vercmp(vers, vers2)) {
-			case -1:
-				WPRINTF("%s/%s %s out of date\n", sync, name, vers);
-				OPRINTF(3, "%s/%s %s => rebuild from %s/%s %s\n", sync, name, vers, sync2, name2, vers2);
-				break;
-			case 0:
-				break;
-			case 1:
-				if (!vcs_package(pkg))
-					WPRINTF("%s/%s %s out of date\n", sync2, name2, vers2);
-				break;
-			}
-			if (!pkg2->maintainer) {
-				WPRINTF("%s/%s %s is an orphan\n", sync2, name2, vers2);
-				OPRINTF(3, "%s/%s %s => adopt package\n", sync2, name2, vers2);
+		if (!(options.analyses & an->analysis))
+			continue;
+		OPRINTF(1, "Performing %s analysis:\n", an->title);
+		if (root->skipped)
+			snap_root_replay(root, an->name);
+		else if (an->analyze && !snap_section_replay(root, an->name, NULL)) {
+			GString *capture = report_capture, *out = root->snapnext ? g_string_new(NULL) : NULL;
+
+			/* writes out its findings as it goes, but counts as checks */
+			t = pac_now();
+			if (out)
+				report_capture = out;
+			an->analyze(slist, pac_only);
+			report_capture = capture;
+			t = pac_now() - t;
+			pac_times[a] += t;
+			pac_phases[PhaseChecks] += t;
+			pac_phases[PhaseReport] -= t;
+			if (out) {
+				/* kept whole, as it depends on all packages */
+				snap_section_add(snap_section_new(root, an->name), "", out->str, out->len);
+				report_replay(out);
+				g_string_free(out, TRUE);
 			}
-		} else {
-			WPRINTF("%s/%s %s foreign\n", sync, name, vers);
 		}
+		if (outputs[a]) {
+			report_replay(outputs[a]);
+			g_string_free(outputs[a], TRUE);
+		}
+		OPRINTF(1, "Done\n\n");
 	}
+	pac_phase(PhaseReport, start);
 }
 
-void
-check_stranded_custom(GSList *s, alpm_pkg_t *pkg)
+/** @brief load and index the databases of all roots and look up the AUR
+  * @param share - whether roots may share identical sync databases
+  */
+static void
+pac_prepare(gboolean share)
 {
-	if (!options.url)
-		return;
-
-	struct dbhash *dbhash = s->data;
-	const char *sync = dbhash->name;
-	const char *name = alpm_pkg_get_name(pkg);
-	const char *vers = alpm_pkg_get_version(pkg);
-
-	aur_pkg_t *pkg2;
-	struct dbhash *dbhash2 = aur_db;
-
-	if ((pkg2 = g_hash_table_lookup(dbhash2->hash, name))) {
-		const char *sync2 = dbhash2->name;
-		const char *name2 = aur_pkg_get_base(pkg2);
-		const char *vers2 = aur_pkg_get_version(pkg2);
-
-		switch (alpm_pkg_vercmp(vers, vers2)) {
-		case -1:
-			WPRINTF("%s/%s %s built from %s/%s %s\n", sync, name, vers, sync2, name2, vers2);
-			WPRINTF("%s/%s %s out of date\n", sync, name, vers);
-			OPRINTF(3, "%s/%s %s => rebuild from %s/%s %s\n", sync, name, vers, sync2, name2, vers2);
-			break;
-		case 0:
-			OPRINTF(2, "%s/%s %s built from %s/%s %s\n", sync, name, vers, sync2, name2, vers2);
-			break;
-		case 1:
-			WPRINTF("%s/%s %s built from %s/%s %s\n", sync, name, vers, sync2, name2, vers2);
-			if (!vcs_package(pkg))
-				WPRINTF("%s/%s %s out of date\n", sync2, name2, vers2);
-			break;
+	GHashTable *shared = NULL;
+	double start = pac_now();
+	GSList *r;
+
+	snap_load();
+	start = pac_phase(PhaseSnapshot, start);
+	/* only worth identifying database files when there are several roots */
+	if (share && options.roots->next)
+		shared = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (r = options.roots; r; r = r->next) {
+		struct pacroot *root = r->data;
+
+		if ((root->skipped = snap_root_unchanged(root))) {
+			DPRINTF(1, "Databases of %s unchanged, not loaded\n", root->root);
+			continue;
 		}
+		pac_load(root, shared);
+		start = pac_phase(PhaseLoad, start);
+		pac_index(root);
+		start = pac_phase(PhaseIndex, start);
+	}
+
+	if (aur_enabled())
+		pac_aur_load();
+	/* the checks must not create it concurrently */
+	aur_db_get();
+	snap_aur();
+	start = pac_phase(PhaseAur, start);
+	/* the previous findings of a root not loaded only hold while its AUR
+	   packages are unchanged: its names were looked up all the same */
+	for (r = options.roots; r; r = r->next) {
+		struct pacroot *root = r->data;
+
+		if (!root->skipped || !snap_root_aur_changed(root))
+			continue;
+		DPRINTF(1, "AUR packages of %s changed, loading it after all\n", root->root);
+		root->skipped = FALSE;
+		pac_load(root, shared);
+		start = pac_phase(PhaseLoad, start);
+		pac_index(root);
+		start = pac_phase(PhaseIndex, start);
+	}
+	if (shared)
+		g_hash_table_destroy(shared);
+}
 
-		if (!pkg2->maintainer) {
-			WPRINTF("%s/%s %s is an orphan\n", sync2, name2, vers2);
-			OPRINTF(3, "%s/%s %s => adopt package\n", sync2, name2, vers2);
+/** @brief release the databases of all roots */
+static void
+pac_release(void)
+{
+	GSList *r;
+
+	/* shared databases belong to the first root that loaded them */
+	for (r = options.roots; r; r = r->next) {
+		struct pacroot *root = r->data;
+
+		g_slist_free_full(root->slist, destroy_dbhash);
+		root->slist = NULL;
+		idset_clear(&root->provided);
+		idset_clear(&root->changed);
+		root->snapprev = root->snapnext = NULL;
+		if (root->snappkgs)
+			json_object_put(root->snappkgs);
+		if (root->aurnames)
+			json_object_put(root->aurnames);
+		root->snappkgs = root->aurnames = NULL;
+		root->skipped = FALSE;
+	}
+	if (snap_prev)
+		json_object_put(snap_prev);
+	if (snap_next)
+		json_object_put(snap_next);
+	snap_prev = snap_next = NULL;
+	idset_clear(&snap_aur_changed);
+	for (r = options.roots; r; r = r->next) {
+		struct pacroot *root = r->data;
+
+		if (root->handle)
+			alpm_unregister_all_syncdbs(root->handle);
+		if (root->lhandle) {
+			alpm_release(root->lhandle);
+			root->lhandle = NULL;
 		}
-	} else {
-		WPRINTF("%s/%s %s stranded\n", sync, name, vers);
 	}
 }
 
-void
-check_missing(GSList *s, alpm_pkg_t *pkg)
+static void
+pac_analyze(void)
 {
-	struct dbhash *dbhash = s->data;
-	const char *sync = dbhash->name;
-	const char *name = alpm_pkg_get_name(pkg);
-	const char *vers = alpm_pkg_get_version(pkg);
+	double begin = pac_now(), start;
+	GSList *r;
 
-	alpm_list_t *d;
+	pac_prepare(TRUE);
+	for (r = options.roots; r; r = r->next)
+		pac_analyze_root(r->data);
+	/* DO MORE! */
+	start = pac_now();
+	snap_save();
+	start = pac_phase(PhaseSave, start);
+	pac_release();
+	pac_phase(PhaseRelease, start);
+	if (options.timings)
+		pac_timings(pac_now() - begin);
+}
 
-	for (d = alpm_pkg_get_depends(pkg); d; d = alpm_list_next(d)) {
-		alpm_depend_t *dep = d->data;
+/** @} */
 
-		const char *dname = dep->name;
+/** @section Daemon
+  * @{ */
 
-		if (!g_hash_table_contains(provided, dname)) {
-			if (options.url) {
-				aur_pkg_t *pkg2;
-				struct dbhash *dbhash2 = aur_db;
+/*
+ * With --daemon, the databases of all roots are loaded and indexed once and
+ * kept in memory.  The local and sync database directories of each root are
+ * watched with inotify, and a database is reloaded and reindexed alone when
+ * its files change.  Requests are read from a Unix socket, one per line, and
+ * each response is terminated by a line consisting of a single period:
+ *
+ *   analyze            the findings of all analyses of all roots
+ *   check NAME         the findings for the packages named NAME
+ *   provides NAME      the packages named NAME or providing NAME
+ *   refresh            reload all databases
+ *   help               list the requests
+ *   quit               close the connection
+ *
+ * The findings of "analyze" are kept until a database is reloaded, and the
+ * packages providing each name are indexed, so that requests are answered
+ * without visiting the packages of any database.
+ *
+ * Everything runs in one main loop, so nothing in it may wait on a client or
+ * on the AUR for long.  Client sockets are non-blocking: responses are queued
+ * per client and written as the client reads them, and no further request of a
+ * client is answered until its last response has been written.  The AUR
+ * lookups of a reload must finish within PAC_DAEMON_AUR_TIMEOUT; names left
+ * unanswered are treated as when the AUR fails.
+ */
+
+#define PAC_DAEMON_SETTLE	500	/* milliseconds to wait for changes to settle */
+#define PAC_DAEMON_AUR_TIMEOUT	10000	/* milliseconds AUR lookups of a reload may take */
+
+/* a root as watched by the daemon */
+struct pac_watch {
+	struct pacroot *root;
+	int lwd;			/* watch descriptor of local directory */
+	int swd;			/* watch descriptor of sync directory */
+	gboolean local;			/* local database changed */
+	GHashTable *syncs;		/* names of sync databases changed */
+};
 
-				if ((pkg2 = g_hash_table_lookup(dbhash2->hash, dname))) {
-					const char *sync2 = dbhash2->name;
-					const char *name2 = aur_pkg_get_base(pkg2);
-					const char *vers2 = aur_pkg_get_version(pkg2);
+/* a package providing a name */
+struct pac_provider {
+	struct pacroot *root;
+	struct dbhash *dbhash;
+	void *pkg;
+};
 
-					WPRINTF("%s/%s %s dependency %s needs: %s/%s %s\n", sync, name, vers, dname, sync2, name2, vers2);
-					OPRINTF(3, "%s/%s %s => build %s from %s/%s %s\n", sync, name, vers, dname, sync2, name2, vers2);
-					if (!pkg2->maintainer) {
-						WPRINTF("%s/%s %s is an orphan\n", sync2, name2, vers2);
-						OPRINTF(3, "%s/%s %s => adopt package\n", sync2, name2, vers2);
-					}
-				} else {
-					WPRINTF("%s/%s %s dependency missing: %s\n", sync, name, vers, dname);
-					OPRINTF(3, "%s/%s %s => create package for %s\n", sync, name, vers, dname);
-				}
-			} else {
-				WPRINTF("%s/%s %s dependency missing: %s\n", sync, name, vers, dname);
-				OPRINTF(3, "%s/%s %s => find package for %s\n", sync, name, vers, dname);
-			}
-		}
-	}
+struct pac_client {
+	int fd;
+	GIOCondition condition;		/* watched for, G_IO_IN or G_IO_OUT */
+	gboolean done;			/* no more requests: end of file or quit */
+	GString *in;			/* requests not yet answered */
+	GString *out;			/* responses not yet written */
+};
 
-}
+struct pac_daemon {
+	GMainLoop *loop;
+	int ifd;			/* inotify descriptor */
+	int sfd;			/* listening socket */
+	guint settle;			/* pending refresh timeout source */
+	GSList *watches;		/* struct pac_watch */
+	GString *findings;		/* of all roots, or NULL when stale */
+	GHashTable *providers;		/* name id -> GPtrArray of struct pac_provider */
+} daemon_state = {
+	.ifd = -1,
+	.sfd = -1,
+};
 
-void
-freeit(gpointer data)
+/** @brief get the default socket path */
+static char *
+daemon_socket(void)
 {
-	free(data);
+	return (g_build_filename(g_get_user_runtime_dir(), NAME ".sock", NULL));
 }
 
-int
-parse_data(const char *data)
+/** @brief discard answers derived from the databases */
+static void
+daemon_invalidate(void)
 {
-	struct json_object *info, *obj, *results, *pkg;
-	enum json_tokener_error err = 0;
-	size_t i, length;
-	struct dbhash *dbhash;
+	struct pac_daemon *d = &daemon_state;
 
-	info = json_tokener_parse_verbose(data, &err);
-	if (!info) {
-		EPRINTF("Could not parse data: %s\n", json_tokener_error_desc(err));
-		return (-1);
-	}
-	if (!json_object_is_type(info, json_type_object)) {
-		EPRINTF("Result wrong object type.\n");
-		goto reject;
-	}
-	if (!(obj = json_object_object_get(info, "version")) || json_object_get_int(obj) != 5) {
-		EPRINTF("Result has wrong version.\n");
-		goto reject;
+	if (d->findings) {
+		g_string_free(d->findings, TRUE);
+		d->findings = NULL;
 	}
-	if (!(obj = json_object_object_get(info, "type")) || strcmp(json_object_get_string(obj), "multiinfo")) {
-		EPRINTF("Result has wrong type.\n");
-		goto reject;
-	}
-	if (!(obj = json_object_object_get(info, "resultcount"))) {
-		EPRINTF("Result has no resultcount.\n");
-		goto reject;
+	if (d->providers) {
+		g_hash_table_destroy(d->providers);
+		d->providers = NULL;
 	}
-	if (!json_object_get_int(obj)) {
-		goto done;
+}
+
+/** @brief reload the local database of a root */
+static void
+daemon_reload_local(struct pacroot *root)
+{
+	alpm_errno_t error = 0;
+	alpm_handle_t *handle;
+	struct dbhash *dbhash, *old = root->slist->data;
+
+	/* libalpm cannot invalidate the package cache of the local database:
+	   read it with a handle of its own, leaving the sync databases
+	   registered with the original handle alone */
+	if (!(handle = alpm_initialize(root->root, root->dbpath, &error)) || error != 0) {
+		EPRINTF("Could not initialize ALPM for %s: %s\n", root->root, alpm_strerror(error));
+		return;
 	}
-	if (!(results = json_object_object_get(info, "results")) || !json_object_is_type(results, json_type_array)) {
-		EPRINTF("Result has no results.\n");
-		goto reject;
+	dbhash = pac_dbhash_new(alpm_get_localdb(handle));
+	dbhash->select = old->select;
+	root->slist->data = dbhash;
+	destroy_dbhash(old);
+	if (root->lhandle)
+		alpm_release(root->lhandle);
+	root->lhandle = handle;
+	DPRINTF(1, "Reloaded local database of %s\n", root->root);
+}
+
+/** @brief reload a sync database of a root */
+static void
+daemon_reload_sync(struct pacroot *root, const char *name)
+{
+	struct dbhash *dbhash = NULL, *old;
+	alpm_db_t *db;
+	GSList *s;
+
+	for (s = root->slist->next; s; s = s->next)
+		if (!strcmp(((struct dbhash *) s->data)->name, name))
+			break;
+	if (!s) {
+		DPRINTF(1, "Ignoring change to unused database %s\n", name);
+		return;
 	}
-	if (!(length = json_object_array_length(results))) {
-		goto done;
+	old = s->data;
+#ifdef HAVE_LIBARCHIVE
+	if (old->store) {
+		char *path = g_strdup_printf("%s/sync/%s.db", root->dbpath, name);
+
+		dbhash = calloc(1, sizeof(*dbhash));
+		dbhash->name = strdup(name);
+		dbhash->refs = 1;
+		if (pac_read_syncdb(dbhash, path)) {
+			EPRINTF("Could not reload database %s\n", name);
+			free(dbhash->name);
+			free(dbhash);
+			g_free(path);
+			return;
+		}
+		g_free(path);
 	}
-	if (!(dbhash = aur_db)) {
-		dbhash = calloc(1, sizeof(*aur_db));
-		dbhash->name = strdup("aur");
-		dbhash->pkgs = NULL;
-		dbhash->hash = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
-		aur_db = dbhash;
+#endif
+	if (!dbhash) {
+		/* the packages of the old database are freed with it */
+		db = old->db;
+		old->pkgs = NULL;
+		alpm_db_unregister(db);
+		if (!(db = alpm_register_syncdb(root->handle, name, ALPM_SIG_DATABASE_OPTIONAL))) {
+			EPRINTF("Could not register database %s: %s\n", name,
+				alpm_strerror(alpm_errno(root->handle)));
+			root->slist = g_slist_delete_link(root->slist, s);
+			destroy_dbhash(old);
+			return;
+		}
+		dbhash = pac_dbhash_new(db);
 	}
-	for (i = 0; i < length; i++) {
-		aur_pkg_t *aur_pkg;
-		const char *str;
-		struct json_object *array;
+	dbhash->select = old->select;
+	dbhash->custom = old->custom;
+	s->data = dbhash;
+	destroy_dbhash(old);
+	DPRINTF(1, "Reloaded database %s of %s\n", name, root->root);
+}
 
-		if (!(pkg = json_object_array_get_idx(results, i)) || !json_object_is_type(pkg, json_type_object)) {
-			EPRINTF("Wrong object type.\n");
-			continue;
+/** @brief reload the changed databases of each root */
+static gboolean
+daemon_refresh(gpointer data)
+{
+	struct pac_daemon *d = &daemon_state;
+	gboolean changed = FALSE;
+	GSList *w;
+
+	(void) data;
+	for (w = d->watches; w; w = w->next) {
+		struct pac_watch *watch = w->data;
+		struct pacroot *root = watch->root;
+		char *lock = g_build_filename(root->dbpath, "db.lck", NULL);
+		gboolean locked = g_file_test(lock, G_FILE_TEST_EXISTS);
+
+		g_free(lock);
+		if (locked && (watch->local || g_hash_table_size(watch->syncs))) {
+			/* pacman is still changing the databases */
+			DPRINTF(1, "Databases of %s locked, waiting\n", root->root);
+			return (G_SOURCE_CONTINUE);
 		}
-		if (!(obj = json_object_object_get(pkg, "Name")) || !(str = json_object_get_string(obj))) {
-			EPRINTF("AUR Package has no name.\n");
+	}
+	for (w = d->watches; w; w = w->next) {
+		struct pac_watch *watch = w->data;
+		struct pacroot *root = watch->root;
+		GHashTableIter iter;
+		gpointer name;
+
+		if (!watch->local && !g_hash_table_size(watch->syncs))
 			continue;
+		if (watch->local)
+			daemon_reload_local(root);
+		g_hash_table_iter_init(&iter, watch->syncs);
+		while (g_hash_table_iter_next(&iter, &name, NULL))
+			daemon_reload_sync(root, name);
+		watch->local = FALSE;
+		g_hash_table_remove_all(watch->syncs);
+		/* only the reloaded databases are indexed again */
+		idset_clear(&root->provided);
+		pac_index(root);
+		changed = TRUE;
+	}
+	if (changed) {
+		if (aur_enabled()) {
+			/* packages that changed or left the AUR are not kept */
+			aur_db_clear();
+			aur_deadline = pac_now() + PAC_DAEMON_AUR_TIMEOUT;
+			pac_aur_load();
+			aur_deadline = 0;
+			aur_db_get();
 		}
-		aur_pkg = calloc(1, sizeof(*aur_pkg));
-		alpm_list_append(&dbhash->pkgs, aur_pkg);
-		aur_pkg->name = strdup(str);
-		g_hash_table_insert(dbhash->hash, strdup(aur_pkg->name), aur_pkg);
-		DPRINTF(1, "AUR package: %s/%s\n", dbhash->name, aur_pkg->name);
-		if (!g_hash_table_lookup(dbhash->hash, aur_pkg->name))
-			EPRINTF("Can't look up %s/%s\n", dbhash->name, aur_pkg->name);
-		if ((obj = json_object_object_get(pkg, "PackageBase")) && (str = json_object_get_string(obj)))
-			aur_pkg->base = strdup(str);
-		if ((obj = json_object_object_get(pkg, "Version")) && (str = json_object_get_string(obj)))
-			aur_pkg->version = strdup(str);
-		if ((obj = json_object_object_get(pkg, "Description")) && (str = json_object_get_string(obj)))
-			aur_pkg->desc = strdup(str);
-		if ((obj = json_object_object_get(pkg, "URL")) && (str = json_object_get_string(obj)))
-			aur_pkg->url = strdup(str);
-		if ((array = json_object_object_get(pkg, "License"))
-		    && json_object_is_type(array, json_type_array)) {
-			size_t n, number;
-
-			number = json_object_array_length(array);
-			for (n = 0; n < number; n++)
-				if ((obj = json_object_array_get_idx(array, n))
-				    && json_object_is_type(obj, json_type_string))
-					alpm_list_append_strdup(&aur_pkg->licenses, json_object_get_string(obj));
-		}
-		if ((array = json_object_object_get(pkg, "Groups")) && json_object_is_type(array, json_type_array)) {
-			size_t n, number;
-
-			number = json_object_array_length(array);
-			for (n = 0; n < number; n++)
-				if ((obj = json_object_array_get_idx(array, n))
-				    && json_object_is_type(obj, json_type_string))
-					alpm_list_append_strdup(&aur_pkg->groups, json_object_get_string(obj));
-		}
-		if ((array = json_object_object_get(pkg, "Depends"))
-		    && json_object_is_type(array, json_type_array)) {
-			size_t n, number;
-
-			number = json_object_array_length(array);
-			for (n = 0; n < number; n++)
-				if ((obj = json_object_array_get_idx(array, n))
-				    && json_object_is_type(obj, json_type_string))
-					alpm_list_append(&aur_pkg->depends,
-							 alpm_dep_from_string(json_object_get_string(obj)));
-		}
-		if ((array = json_object_object_get(pkg, "OptDepends"))
-		    && json_object_is_type(array, json_type_array)) {
-			size_t n, number;
-
-			number = json_object_array_length(array);
-			for (n = 0; n < number; n++)
-				if ((obj = json_object_array_get_idx(array, n))
-				    && json_object_is_type(obj, json_type_string))
-					alpm_list_append(&aur_pkg->optdepends,
-							 alpm_dep_from_string(json_object_get_string(obj)));
-		}
-		if ((array = json_object_object_get(pkg, "CheckDepends"))
-		    && json_object_is_type(array, json_type_array)) {
-			size_t n, number;
-
-			number = json_object_array_length(array);
-			for (n = 0; n < number; n++)
-				if ((obj = json_object_array_get_idx(array, n))
-				    && json_object_is_type(obj, json_type_string))
-					alpm_list_append(&aur_pkg->checkdepends,
-							 alpm_dep_from_string(json_object_get_string(obj)));
-		}
-		if ((array = json_object_object_get(pkg, "MakeDepends"))
-		    && json_object_is_type(array, json_type_array)) {
-			size_t n, number;
-
-			number = json_object_array_length(array);
-			for (n = 0; n < number; n++)
-				if ((obj = json_object_array_get_idx(array, n))
-				    && json_object_is_type(obj, json_type_string))
-					alpm_list_append(&aur_pkg->makedepends,
-							 alpm_dep_from_string(json_object_get_string(obj)));
-		}
-		if ((array = json_object_object_get(pkg, "Conflicts"))
-		    && json_object_is_type(array, json_type_array)) {
-			size_t n, number;
-
-			number = json_object_array_length(array);
-			for (n = 0; n < number; n++)
-				if ((obj = json_object_array_get_idx(array, n))
-				    && json_object_is_type(obj, json_type_string))
-					alpm_list_append(&aur_pkg->conflicts,
-							 alpm_dep_from_string(json_object_get_string(obj)));
-		}
-		if ((array = json_object_object_get(pkg, "Provides"))
-		    && json_object_is_type(array, json_type_array)) {
-			size_t n, number;
-
-			number = json_object_array_length(array);
-			for (n = 0; n < number; n++)
-				if ((obj = json_object_array_get_idx(array, n))
-				    && json_object_is_type(obj, json_type_string))
-					alpm_list_append(&aur_pkg->provides,
-							 alpm_dep_from_string(json_object_get_string(obj)));
-		}
-		if ((array = json_object_object_get(pkg, "Replaces"))
-		    && json_object_is_type(array, json_type_array)) {
-			size_t n, number;
-
-			number = json_object_array_length(array);
-			for (n = 0; n < number; n++)
-				if ((obj = json_object_array_get_idx(array, n))
-				    && json_object_is_type(obj, json_type_string))
-					alpm_list_append(&aur_pkg->replaces,
-							 alpm_dep_from_string(json_object_get_string(obj)));
-		}
-		if ((obj = json_object_object_get(pkg, "Maintainer"))
-				&& json_object_is_type(obj, json_type_string)
-				&& (str = json_object_get_string(obj))) {
-			aur_pkg->maintainer = strdup(str);
-		}
-	}
-      done:
-	json_object_put(info);
-	return (0);
-      reject:
-	json_object_put(info);
-	return (-1);
+		daemon_invalidate();
+	}
+	d->settle = 0;
+	return (G_SOURCE_REMOVE);
 }
 
-size_t
-writedata_callback(char *ptr, size_t size, size_t nmemb, void *userdata)
+/** @brief mark all databases of all roots changed */
+static void
+daemon_changed_all(void)
 {
-	GStrvBuilder *svb = userdata;
-	gchar *data;
+	struct pac_daemon *d = &daemon_state;
+	GSList *w, *s;
 
-	(void) size;
-	if ((data = g_strndup(ptr, nmemb))) {
-		g_strv_builder_add(svb, data);
-		return (nmemb);
+	for (w = d->watches; w; w = w->next) {
+		struct pac_watch *watch = w->data;
+
+		watch->local = TRUE;
+		for (s = watch->root->slist->next; s; s = s->next)
+			g_hash_table_add(watch->syncs, g_strdup(((struct dbhash *) s->data)->name));
 	}
-	return (0);
 }
 
-int
-aur_lookup_info(const char *uri)
+static void
+daemon_schedule(void)
 {
-	CURL *curl;
+	struct pac_daemon *d = &daemon_state;
 
-	/* lookup info using CURL and parse result with JSON */
-	if (options.dryrun) {
-		OPRINTF(1, "Would look up:\n%s\n", uri);
-		return (0);
+	if (d->settle)
+		g_source_remove(d->settle);
+	d->settle = g_timeout_add(PAC_DAEMON_SETTLE, daemon_refresh, NULL);
+}
+
+static gboolean
+daemon_inotify(gint fd, GIOCondition condition, gpointer data)
+{
+	struct pac_daemon *d = &daemon_state;
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	ssize_t len;
+	char *p;
+	GSList *w;
+
+	(void) condition;
+	(void) data;
+	if ((len = read(fd, buf, sizeof(buf))) <= 0) {
+		if (len < 0 && (errno == EINTR || errno == EAGAIN))
+			return (G_SOURCE_CONTINUE);
+		EPRINTF("inotify: %s\n", len ? strerror(errno) : "end of file");
+		return (G_SOURCE_CONTINUE);
 	}
-	if (!(curl = curl_easy_init())) {
-		EPRINTF("Could not get CURL easy handle.\n");
-		return (-1);
+	for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+		ev = (const struct inotify_event *) p;
+		if (ev->mask & IN_Q_OVERFLOW) {
+			daemon_changed_all();
+			continue;
+		}
+		for (w = d->watches; w; w = w->next) {
+			struct pac_watch *watch = w->data;
+
+			if (ev->wd == watch->lwd)
+				watch->local = TRUE;
+			else if (ev->wd == watch->swd && ev->len && g_str_has_suffix(ev->name, ".db"))
+				g_hash_table_add(watch->syncs, g_strndup(ev->name, strlen(ev->name) - 3));
+		}
 	}
-	curl_easy_setopt(curl, CURLOPT_URL, uri);
-	GStrvBuilder *svb = g_strv_builder_new();
+	daemon_schedule();
+	return (G_SOURCE_CONTINUE);
+}
 
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, svb);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writedata_callback);
-	DPRINTF(1, "Lookup up in AUR:\n%s\n", uri);
-	CURLcode res = curl_easy_perform(curl);
+/** @brief watch the database directories of each root */
+static int
+daemon_watch(void)
+{
+	struct pac_daemon *d = &daemon_state;
+	GSList *r;
 
-	curl_easy_cleanup(curl);
-	if (res != CURLE_OK) {
-		EPRINTF("CURL error: %s\n", curl_easy_strerror(res));
+	if ((d->ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+		EPRINTF("inotify_init1: %s\n", strerror(errno));
 		return (-1);
 	}
-	GStrv strv = g_strv_builder_end(svb);
-
-	g_strv_builder_unref(svb);
-	if (!strv) {
-		return (-1);
+	for (r = options.roots; r; r = r->next) {
+		struct pac_watch *watch = calloc(1, sizeof(*watch));
+		char *path;
+
+		watch->root = r->data;
+		watch->syncs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		/* packages are installed and removed as directories */
+		path = g_build_filename(watch->root->dbpath, "local", NULL);
+		if ((watch->lwd = inotify_add_watch(d->ifd, path, IN_CREATE | IN_DELETE | IN_MOVED_FROM
+						    | IN_MOVED_TO | IN_ONLYDIR)) == -1)
+			EPRINTF("Could not watch %s: %s\n", path, strerror(errno));
+		g_free(path);
+		/* sync databases are downloaded and renamed into place */
+		path = g_build_filename(watch->root->dbpath, "sync", NULL);
+		if ((watch->swd = inotify_add_watch(d->ifd, path, IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_TO
+						    | IN_ONLYDIR)) == -1)
+			EPRINTF("Could not watch %s: %s\n", path, strerror(errno));
+		g_free(path);
+		d->watches = g_slist_append(d->watches, watch);
 	}
-	gchar *data = g_strjoinv(NULL, strv);
+	g_unix_fd_add(d->ifd, G_IO_IN, daemon_inotify, NULL);
+	return (0);
+}
 
-	g_strfreev(strv);
-	if (!data) {
-		return (-1);
+static void
+daemon_provider_add(GHashTable *providers, const char *name, struct pacroot *root,
+		    struct dbhash *dbhash, void *pkg)
+{
+	gpointer key = GUINT_TO_POINTER(strtab_intern(&names, name));
+	struct pac_provider *provider;
+	GPtrArray *array;
+
+	if (!(array = g_hash_table_lookup(providers, key))) {
+		array = g_ptr_array_new_with_free_func(g_free);
+		g_hash_table_insert(providers, key, array);
 	}
+	provider = g_new(struct pac_provider, 1);
+	provider->root = root;
+	provider->dbhash = dbhash;
+	provider->pkg = pkg;
+	g_ptr_array_add(array, provider);
+}
+
+/** @brief index the packages of all roots by the names they provide */
+static GHashTable *
+daemon_providers(void)
+{
+	struct pac_daemon *d = &daemon_state;
+	GSList *r, *s;
 
-	DPRINTF(1, "Got AUR info:\n%s\n", data);
-	int err = parse_data(data);
+	if (d->providers)
+		return (d->providers);
+	d->providers = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+					     (GDestroyNotify) g_ptr_array_unref);
+	for (r = options.roots; r; r = r->next) {
+		struct pacroot *root = r->data;
 
-	g_free(data);
-	return (err);
+		for (s = root->slist; s; s = s->next) {
+			struct dbhash *dbhash = s->data;
+			alpm_list_t *p, *dp;
+
+			for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
+				const char *name = dbhash_pkg_get_name(dbhash, p->data);
+
+				daemon_provider_add(d->providers, name, root, dbhash, p->data);
+				for (dp = dbhash_pkg_get_provides(dbhash, p->data); dp; dp = alpm_list_next(dp)) {
+					alpm_depend_t *dep = dp->data;
+
+					if (strcmp(dep->name, name))
+						daemon_provider_add(d->providers, dep->name, root, dbhash, p->data);
+				}
+			}
+		}
+	}
+	return (d->providers);
 }
 
-int
-aur_lookup(GSList *alist)
+/** @brief perform the analyses of all roots, or those of packages of a name */
+static void
+daemon_analyze(const char *name, GString *text)
 {
-	GSList *a;
-	static char buf[AUR_MAXLEN + 1] = { 0, };
-	int urllen, err;
+	GString *capture = g_string_new(NULL);
+	GSList *r;
+
+	report_capture = capture;
+	pac_only = name;
+	for (r = options.roots; r; r = r->next)
+		pac_analyze_root(r->data);
+	pac_only = NULL;
+	report_capture = NULL;
+	report_text(capture, text);
+	g_string_free(capture, TRUE);
+}
 
-	for (a = alist; a; a = a->next) {
-		strcpy(buf, options.url);
-		strcat(buf, "?v=5&type=info");
-		urllen = strlen(buf);
-		for (; a; a = a->next) {
-			int len = strlen(a->data);
+/** @brief answer a request
+  * @return FALSE when the connection is to be closed
+  */
+static gboolean
+daemon_request(char *line, GString *reply)
+{
+	struct pac_daemon *d = &daemon_state;
+	char *arg;
 
-			if (urllen + 7 + len > AUR_MAXLEN)
-				break;
-			strcat(buf, "&arg[]=");
-			strcat(buf, a->data);
-			urllen += 7 + len;
+	g_strstrip(line);
+	if ((arg = strchr(line, ' '))) {
+		*arg++ = '\0';
+		g_strchug(arg);
+	}
+	if (!strcmp(line, "analyze") && !arg) {
+		if (!d->findings) {
+			d->findings = g_string_new(NULL);
+			daemon_analyze(NULL, d->findings);
 		}
-		if ((err = aur_lookup_info(buf)))
-			return (err);
-		if (!a)
-			break;
+		g_string_append_len(reply, d->findings->str, d->findings->len);
+	} else if (!strcmp(line, "check") && arg) {
+		daemon_analyze(arg, reply);
+	} else if (!strcmp(line, "provides") && arg) {
+		GPtrArray *array;
+		guint i;
+
+		array = g_hash_table_lookup(daemon_providers(), GUINT_TO_POINTER(strtab_find(&names, arg)));
+		for (i = 0; array && i < array->len; i++) {
+			struct pac_provider *provider = g_ptr_array_index(array, i);
+
+			if (options.roots->next)
+				g_string_append_printf(reply, "%s: ", provider->root->root);
+			g_string_append_printf(reply, "%s/%s %s\n", provider->dbhash->name,
+					       dbhash_pkg_get_name(provider->dbhash, provider->pkg),
+					       dbhash_pkg_get_version(provider->dbhash, provider->pkg));
+		}
+	} else if (!strcmp(line, "refresh") && !arg) {
+		daemon_changed_all();
+		if (d->settle)
+			g_source_remove(d->settle);
+		d->settle = 0;
+		/* while the databases are locked, wait for them as for a change */
+		if (daemon_refresh(NULL) == G_SOURCE_CONTINUE)
+			daemon_schedule();
+	} else if (!strcmp(line, "help") && !arg) {
+		g_string_append(reply, "analyze\ncheck NAME\nprovides NAME\nrefresh\nhelp\nquit\n");
+	} else if (!strcmp(line, "quit") && !arg) {
+		return (FALSE);
+	} else if (*line) {
+		g_string_append_printf(reply, "E: invalid request: %s\n", line);
 	}
-	return (0);
+	g_string_append(reply, ".\n");
+	return (TRUE);
 }
 
 static void
-pac_analyze(void)
+daemon_client_free(struct pac_client *client)
 {
+	close(client->fd);
+	g_string_free(client->in, TRUE);
+	g_string_free(client->out, TRUE);
+	free(client);
+}
 
-	const char *version = alpm_version();
+static gboolean daemon_client(gint fd, GIOCondition condition, gpointer data);
 
-	DPRINTF(1, "ALPM version: %s\n", version);
+static void
+daemon_client_watch(struct pac_client *client, GIOCondition condition)
+{
+	client->condition = condition;
+	g_unix_fd_add(client->fd, condition | G_IO_HUP | G_IO_ERR, daemon_client, client);
+}
 
-	int caps = alpm_capabilities();
+/** @brief answer the requests read, as far as the responses can be written
+  * @return FALSE when the client cannot be written to
+  */
+static gboolean
+daemon_client_serve(struct pac_client *client)
+{
+	char *nl;
+	ssize_t n;
+
+	for (;;) {
+		/* a request is answered only once the last response is written */
+		while (!client->out->len && (nl = memchr(client->in->str, '\n', client->in->len))) {
+			*nl = '\0';
+			if (!daemon_request(client->in->str, client->out)) {
+				client->done = TRUE;
+				g_string_truncate(client->in, 0);
+				break;
+			}
+			g_string_erase(client->in, 0, nl - client->in->str + 1);
+		}
+		if (!client->out->len)
+			return (TRUE);
+		if ((n = send(client->fd, client->out->str, client->out->len, MSG_NOSIGNAL)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return (errno == EAGAIN || errno == EWOULDBLOCK);
+		}
+		g_string_erase(client->out, 0, n);
+	}
+}
 
-	if (caps & ALPM_CAPABILITY_NLS)
-		DPRINTF(1, "ALPM capability NLS\n");
-	if (caps & ALPM_CAPABILITY_DOWNLOADER)
-		DPRINTF(1, "ALPM capability DOWNLOADER\n");
-	if (caps & ALPM_CAPABILITY_SIGNATURES)
-		DPRINTF(1, "ALPM capability SIGNATURES\n");
+static gboolean
+daemon_client(gint fd, GIOCondition condition, gpointer data)
+{
+	struct pac_client *client = data;
+	gboolean keep = TRUE;
+	char buf[4096];
+	ssize_t len;
+
+	if (condition & G_IO_IN) {
+		if ((len = read(fd, buf, sizeof(buf))) > 0)
+			g_string_append_len(client->in, buf, len);
+		else if (len == 0 || (errno != EINTR && errno != EAGAIN))
+			client->done = TRUE;
+	}
+	if ((condition & G_IO_ERR) || ((condition & G_IO_HUP) && !(condition & G_IO_IN)))
+		keep = FALSE;
+	if (keep)
+		keep = daemon_client_serve(client);
+	/* once done, the connection is closed when the last response is out */
+	if (!keep || (client->done && !client->out->len)) {
+		daemon_client_free(client);
+		return (G_SOURCE_REMOVE);
+	}
+	if (client->out->len && client->condition != G_IO_OUT) {
+		daemon_client_watch(client, G_IO_OUT);
+		return (G_SOURCE_REMOVE);
+	}
+	if (!client->out->len && client->condition != G_IO_IN) {
+		daemon_client_watch(client, G_IO_IN);
+		return (G_SOURCE_REMOVE);
+	}
+	return (G_SOURCE_CONTINUE);
+}
 
-	alpm_errno_t error = 0;
-	alpm_handle_t *handle = alpm_initialize("/", "/var/lib/pacman/", &error);
+static gboolean
+daemon_accept(gint fd, GIOCondition condition, gpointer data)
+{
+	struct pac_client *client;
+	int cfd;
+
+	(void) condition;
+	(void) data;
+	if ((cfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) == -1) {
+		if (errno != EINTR && errno != EAGAIN)
+			EPRINTF("accept: %s\n", strerror(errno));
+		return (G_SOURCE_CONTINUE);
+	}
+	client = calloc(1, sizeof(*client));
+	client->fd = cfd;
+	client->in = g_string_new(NULL);
+	client->out = g_string_new(NULL);
+	daemon_client_watch(client, G_IO_IN);
+	return (G_SOURCE_CONTINUE);
+}
+
+/** @brief listen on the Unix socket */
+static int
+daemon_listen(void)
+{
+	struct pac_daemon *d = &daemon_state;
+	struct sockaddr_un addr = { .sun_family = AF_UNIX, };
+	struct stat st;
+
+	if (strlen(options.socket) >= sizeof(addr.sun_path)) {
+		EPRINTF("Socket path too long: %s\n", options.socket);
+		return (-1);
+	}
+	strcpy(addr.sun_path, options.socket);
+	/* remove a socket left behind by a previous daemon */
+	if (!lstat(options.socket, &st) && S_ISSOCK(st.st_mode))
+		unlink(options.socket);
+	if ((d->sfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
+		EPRINTF("socket: %s\n", strerror(errno));
+		return (-1);
+	}
+	if (bind(d->sfd, (struct sockaddr *) &addr, sizeof(addr)) == -1 || listen(d->sfd, SOMAXCONN) == -1) {
+		EPRINTF("Could not listen on %s: %s\n", options.socket, strerror(errno));
+		close(d->sfd);
+		d->sfd = -1;
+		return (-1);
+	}
+	g_unix_fd_add(d->sfd, G_IO_IN, daemon_accept, NULL);
+	DPRINTF(1, "Listening on %s\n", options.socket);
+	return (0);
+}
+
+static gboolean
+daemon_signal(gpointer data)
+{
+	(void) data;
+	g_main_loop_quit(daemon_state.loop);
+	return (G_SOURCE_CONTINUE);
+}
 
-	if (!handle || error != 0) {
-		EPRINTF("Could not initialize ALPM: %s\n", alpm_strerror(error));
+static void
+pac_daemon(void)
+{
+	struct pac_daemon *d = &daemon_state;
+
+	/* findings are kept in memory instead of in a snapshot */
+	options.incremental = 0;
+	/* databases are reloaded one at a time, so are never shared */
+	pac_prepare(FALSE);
+	if (daemon_watch() || daemon_listen()) {
+		pac_release();
 		exit(EXIT_FAILURE);
 	}
-	alpm_list_t *list;
-	alpm_list_t *d;
-
-	list = get_database_names();
-	for (d = list; d; d = alpm_list_next(d)) {
-		const char *name = d->data;
+	d->loop = g_main_loop_new(NULL, FALSE);
+	g_unix_signal_add(SIGINT, daemon_signal, NULL);
+	g_unix_signal_add(SIGTERM, daemon_signal, NULL);
+	g_main_loop_run(d->loop);
+	g_main_loop_unref(d->loop);
+	close(d->sfd);
+	unlink(options.socket);
+	close(d->ifd);
+	daemon_invalidate();
+	pac_release();
+}
 
-		alpm_register_syncdb(handle, name, ALPM_SIG_DATABASE_OPTIONAL);
-		DPRINTF(1, "ALPM database: %s\n", name);
-	}
-	provided = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
-	GSList *slist = NULL;
-	struct dbhash *dbhash;
-	alpm_db_t *db;
+/** @} */
 
+/** @section Benchmark
+  * @{ */
 
-	dbhash = calloc(1, sizeof(*dbhash));
-	db = alpm_get_localdb(handle);
-	dbhash->name = strdup(alpm_db_get_name(db));
-	dbhash->pkgs = alpm_db_get_pkgcache(db);
-	dbhash->hash = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
-	slist = g_slist_append(slist, dbhash);
-	{
-		size_t count = 0;
+#define BENCH_ROUNDS	5
 
-		DPRINTF(1, "ALPM database: %s\n", dbhash->name);
-		alpm_list_t *p;
+static size_t
+bench_heap(void)
+{
+#ifdef HAVE_MALLINFO2
+	return (mallinfo2().uordblks);
+#else
+	return (0);
+#endif
+}
 
-		for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-			alpm_pkg_t *pkg = p->data;
-			const char *name = alpm_pkg_get_name(pkg);
+struct bench_result {
+	double build;			/* milliseconds to build */
+	double lookup;			/* milliseconds to look up */
+	size_t heap;			/* heap bytes in use when built */
+	size_t hits;			/* lookups that found a package */
+};
 
-			DPRINTF(1, "ALPM package: %s/%s\n", dbhash->name, name);
-			g_hash_table_insert(dbhash->hash, strdup(name), pkg);
-			count++;
+static void
+bench_report(const char *what, struct bench_result *r)
+{
+	fprintf(stdout, "  %-12s build %9.3f ms  lookup %9.3f ms  heap %10zu bytes  (%zu hits)\n",
+		what, r->build, r->lookup, r->heap, r->hits);
+}
 
-			g_hash_table_add(provided, strdup(name));
-			alpm_list_t *d;
-			for (d = alpm_pkg_get_provides(pkg); d; d = alpm_list_next(d)) {
-				alpm_depend_t *dep = d->data;
-				g_hash_table_add(provided, strdup(dep->name));
-			}
-		}
-		DPRINTF(1, "ALPM database: %s (%zd packages)\n", dbhash->name, count);
-	}
-	list = alpm_get_syncdbs(handle);
-	for (d = list; d; d = alpm_list_next(d)) {
-		dbhash = calloc(1, sizeof(*dbhash));
-		db = d->data;
-		dbhash->name = strdup(alpm_db_get_name(db));
-		dbhash->pkgs = alpm_db_get_pkgcache(db);
-		dbhash->hash = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
-		slist = g_slist_append(slist, dbhash);
-		{
-			size_t count = 0;
+static void
+bench_best(struct bench_result *best, struct bench_result *r)
+{
+	if (!best->build || r->build < best->build)
+		best->build = r->build;
+	if (!best->lookup || r->lookup < best->lookup)
+		best->lookup = r->lookup;
+	best->heap = r->heap;
+	best->hits = r->hits;
+}
 
-			DPRINTF(1, "ALPM database: %s\n", dbhash->name);
-			alpm_list_t *p;
+/** @brief build and probe the name indexes the way pacana once did
+  *
+  * One GHashTable per database and a GHashTable of provided names, each keyed
+  * with strdup()'ed names.  The lookups performed are those of the SHADOW
+  * analysis: each package name probed in every lower priority database.
+  */
+static void
+bench_index_ghash(GSList *slist, struct bench_result *r)
+{
+	guint ndbs = g_slist_length(slist), i, j;
+	GHashTable **hash = calloc(ndbs, sizeof(*hash));
+	GHashTable *prov;
+	size_t heap = bench_heap();
+	double start = pac_now();
+	GSList *s;
 
-			for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-				alpm_pkg_t *pkg = p->data;
-				const char *name = alpm_pkg_get_name(pkg);
+	prov = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+	for (i = 0, s = slist; s; s = s->next, i++) {
+		struct dbhash *dbhash = s->data;
+		alpm_list_t *p, *d;
 
-				DPRINTF(1, "ALPM package: %s/%s\n", dbhash->name, name);
-				g_hash_table_insert(dbhash->hash, strdup(name), pkg);
-				count++;
+		hash[i] = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+		for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
+			const char *name = dbhash_pkg_get_name(dbhash, p->data);
 
-				g_hash_table_add(provided, strdup(name));
-				alpm_list_t *d;
-				for (d = alpm_pkg_get_provides(pkg); d; d = alpm_list_next(d)) {
-					alpm_depend_t *dep = d->data;
-					g_hash_table_add(provided, strdup(dep->name));
-				}
-			}
-			DPRINTF(1, "ALPM database: %s (%zd packages)\n", dbhash->name, count);
+			g_hash_table_insert(hash[i], strdup(name), p->data);
+			g_hash_table_add(prov, strdup(name));
+			for (d = dbhash_pkg_get_provides(dbhash, p->data); d; d = alpm_list_next(d))
+				g_hash_table_add(prov, strdup(((alpm_depend_t *) d->data)->name));
 		}
 	}
-
-	GSList *s;
-
-	/* 
-	 * When the AUR is activated we need a list of all packages that exist
-	 * in the local database that do not exist in any sync database and the
-	 * list of all packages that exist in a "custom" sync database, and then
-	 * obtain information about them from the AUR.
-	 */
-	if (options.url) {
-		GSList *alist = NULL;
-
-		dbhash = slist->data;
+	r->build = pac_now() - start;
+	r->heap = bench_heap() - heap;
+	r->hits = 0;
+	start = pac_now();
+	for (i = 0, s = slist; s; s = s->next, i++) {
+		struct dbhash *dbhash = s->data;
 		alpm_list_t *p;
 
-		/* First, add to the list the names of all packages that exist in the
-		   local database that do not exist in any sync database. */
 		for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-			alpm_pkg_t *pkg = p->data;
-			const char *name = alpm_pkg_get_name(pkg);
-			int found = 0;
-
-			/* skip local database */
-			for (s = slist->next; s; s = s->next) {
-				dbhash = s->data;
-				if (g_hash_table_lookup(dbhash->hash, name)) {
-					found = 1;
-					break;
-				}
-			}
-			if (!found) {
-				DPRINTF(1, "Adding to AUR list: %s\n", name);
-				alist = g_slist_append(alist, g_uri_escape_string(name, NULL, FALSE));
-			}
-		}
-		/* Second, get a list of sync databases that are considered "custom".  */
-		/* skip local database */
-		for (s = slist->next; s; s = s->next) {
-			dbhash = s->data;
-			const char *sync = dbhash->name;
-
-			if (options.custom) {
-				switch (in_list(options.custom, sync)) {
-				case -1:	/* in list with ! prefixed */
-					dbhash->custom = FALSE;
-					continue;
-				case 0:	/* not in list */
-					dbhash->custom = FALSE;
-					continue;
-				case 1:	/* in list without ! prefixed */
-					dbhash->custom = TRUE;
-					break;
-				}
-			} else {
-				switch (in_list(ARCH_STANDARD_REPOS, sync)) {
-				case -1:	/* in list with ! prefixed */
-					dbhash->custom = TRUE;
-					break;
-				case 0:	/* not in list */
-					dbhash->custom = TRUE;
-					break;
-				case 1:	/* in list without ! prefixed */
-					dbhash->custom = FALSE;
-					continue;
-				}
-			}
-			DPRINTF(1, "Adding to AUR list: --> packages from %s <--\n", sync);
-			/* Third, add to the list the names of all packages from the
-			   custom databases. */
-			alpm_list_t *p;
-
-			for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-				alpm_pkg_t *pkg = p->data;
-				const char *name = alpm_pkg_get_name(pkg);
+			const char *name = dbhash_pkg_get_name(dbhash, p->data);
 
-				DPRINTF(1, "Adding to AUR list: %s\n", name);
-				alist = g_slist_append(alist, g_uri_escape_string(name, NULL, FALSE));
-			}
-		}
-		if (options.analyses & PACANA_ANALYSIS_MISSING) {
-			/* Find all the missing dependencies (those in no sync
-			   database) and add them to the AUR list. */
-			for (s = slist; s; s = s->next) {
-				dbhash = s->data;
-				alpm_list_t *p;
-				for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-					alpm_pkg_t *pkg = p->data;
-
-					alpm_list_t *d;
-					for (d = alpm_pkg_get_depends(pkg); d; d = alpm_list_next(d)) {
-						alpm_depend_t *dep = d->data;
-						const char *name = dep->name;
-
-						if (!g_hash_table_contains(provided, name)) {
-							DPRINTF(1, "Adding to AUR list: %s\n", name);
-							alist = g_slist_append(alist, g_uri_escape_string(name, NULL, FALSE));
-						}
-					}
-				}
-			}
-		}
-		if (aur_lookup(alist)) {
-			/* mark AUR as unusable */
-			free(options.url);
-			options.url = NULL;
+			for (j = i + 1; j < ndbs; j++)
+				if (g_hash_table_lookup(hash[j], name))
+					r->hits++;
+			if (g_hash_table_contains(prov, name))
+				r->hits++;
 		}
-		// g_slist_free_full(alist, freeit);
 	}
+	r->lookup = pac_now() - start;
+	for (i = 0; i < ndbs; i++)
+		g_hash_table_destroy(hash[i]);
+	g_hash_table_destroy(prov);
+	free(hash);
+}
 
-	if (options.analyses & PACANA_ANALYSIS_SHADOW) {
-		OPRINTF(1, "Performing SHADOW analysis:\n");
-		/* skip local database */
-		for (s = slist->next; s; s = s->next) {
-			dbhash = s->data;
-			alpm_list_t *p;
+/** @brief build and probe the interned name indexes as pac_index() does */
+static void
+bench_index_interned(GSList *slist, struct bench_result *r)
+{
+	guint ndbs = g_slist_length(slist), i, j;
+	struct nameidx *idx = calloc(ndbs, sizeof(*idx));
+	struct strtab tab = { NULL, };
+	struct idset prov = { NULL, };
+	size_t heap = bench_heap();
+	double start = pac_now();
+	GSList *s;
 
-			for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-				alpm_pkg_t *pkg = p->data;
+	for (i = 0, s = slist; s; s = s->next, i++) {
+		struct dbhash *dbhash = s->data;
+		alpm_list_t *p, *d;
 
-				check_shadow(s, pkg);
-			}
+		for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
+			uint32_t id = strtab_intern(&tab, dbhash_pkg_get_name(dbhash, p->data));
+
+			nameidx_insert(&idx[i], id, p->data);
+			idset_add(&prov, id);
+			for (d = dbhash_pkg_get_provides(dbhash, p->data); d; d = alpm_list_next(d))
+				idset_add(&prov, strtab_intern(&tab, ((alpm_depend_t *) d->data)->name));
 		}
-		OPRINTF(1, "Done\n\n");
 	}
-	if (options.analyses & PACANA_ANALYSIS_PROVIDES) {
-		OPRINTF(1, "Performing PROVIDES analysis:\n");
-		/* skip local database */
-		for (s = slist->next; s; s = s->next) {
-			dbhash = s->data;
-			alpm_list_t *p;
+	r->build = pac_now() - start;
+	r->heap = bench_heap() - heap;
+	r->hits = 0;
+	start = pac_now();
+	for (i = 0, s = slist; s; s = s->next, i++) {
+		struct dbhash *dbhash = s->data;
+		alpm_list_t *p;
 
-			for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-				alpm_pkg_t *pkg = p->data;
+		for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
+			uint32_t id = strtab_find(&tab, dbhash_pkg_get_name(dbhash, p->data));
 
-				check_provides(s, pkg);
-			}
+			for (j = i + 1; j < ndbs; j++)
+				if (nameidx_lookup(&idx[j], id))
+					r->hits++;
+			if (idset_contains(&prov, id))
+				r->hits++;
 		}
-		OPRINTF(1, "Done\n\n");
 	}
-	if (options.analyses & PACANA_ANALYSIS_VCSCHECK) {
-		OPRINTF(1, "Performing VCSCHECK analysis:\n");
-		/* skip local database */
-		for (s = slist->next; s; s = s->next) {
-			dbhash = s->data;
-			alpm_list_t *p;
-
-			for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-				alpm_pkg_t *pkg = p->data;
+	r->lookup = pac_now() - start;
+	for (i = 0; i < ndbs; i++)
+		nameidx_clear(&idx[i]);
+	idset_clear(&prov);
+	strtab_clear(&tab);
+	free(idx);
+}
 
-				check_vcscheck(s, pkg);
-			}
+/** @brief a random version, mostly of the forms found in the databases */
+static char *
+bench_version(void)
+{
+	static const char *alpha[] = { "a", "b", "rc", "alpha", "pre", "r", "git", "beta" };
+	GString *v = g_string_new(NULL);
+	int i, n;
+
+	if (!(random() % 8))
+		g_string_append_printf(v, "%ld:", random() % 3);
+	for (i = 0, n = 1 + random() % 4; i < n; i++) {
+		if (i)
+			g_string_append(v, random() % 16 ? "." : (random() % 2 ? ".." : "_"));
+		switch (random() % 8) {
+		case 0:
+			g_string_append(v, alpha[random() % G_N_ELEMENTS(alpha)]);
+			break;
+		case 1:
+			g_string_append_printf(v, "0%ld", random() % 10);
+			break;
+		case 2:
+			g_string_append_printf(v, "%ld%s", random() % 10, alpha[random() % G_N_ELEMENTS(alpha)]);
+			break;
+		case 3:
+			g_string_append_printf(v, "%ld", 20000000 + random() % 400000);
+			break;
+		default:
+			g_string_append_printf(v, "%ld", random() % 12);
+			break;
 		}
-		OPRINTF(1, "Done\n\n");
-	}
-	if (options.analyses & PACANA_ANALYSIS_OUTDATED) {
-		OPRINTF(1, "Performing OUTDATED analysis:\n");
-		WPRINTF("TODO!\n");
-		OPRINTF(1, "Done\n\n");
 	}
-	if (options.analyses & PACANA_ANALYSIS_ALTERNATE) {
-		OPRINTF(1, "Performing ALTERNATE analysis:\n");
-		WPRINTF("TODO!\n");
-		OPRINTF(1, "Done\n\n");
-	}
-	if (options.analyses & PACANA_ANALYSIS_STRANDED) {
-		OPRINTF(1, "Performing STRANDED analysis:\n");
-		if (options.url) {
-			/* local database */
-			if ((s = slist)) {
-				dbhash = s->data;
+	if (random() % 8)
+		g_string_append_printf(v, "-%ld", 1 + random() % 3);
+	if (!(random() % 8))
+		g_string_append_printf(v, ".%ld", random() % 3);
+	return (g_string_free(v, FALSE));
+}
 
-				alpm_list_t *p;
+#define BENCH_VERCMP_PAIRS	1000000
+
+/** @brief check keyed comparison against alpm_pkg_vercmp() and time both
+  *
+  * The versions compared are those of the packages of the databases and
+  * random versions, in random pairs.  Each pair is compared with
+  * alpm_pkg_vercmp(), through the version keys, and with the memoized
+  * comparison, which must all agree.
+  *
+  * @return the number of pairs on which the comparisons disagree
+  */
+static size_t
+bench_vercmp(GSList *slist)
+{
+	GPtrArray *versions = g_ptr_array_new_with_free_func(g_free);
+	struct verkey *keys;
+	gboolean *numeric;
+	size_t *pairs, i, nnumeric = 0, mismatches = 0, keyed = 0;
+	double start, plain = 0, fast = 0, memo = 0;
+	int result, round;
+	GSList *s;
 
-				for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-					alpm_pkg_t *pkg = p->data;
+	srandom(1);
+	for (s = slist; s; s = s->next) {
+		struct dbhash *dbhash = s->data;
+		alpm_list_t *p;
 
-					check_stranded_local(s, pkg);
-				}
+		for (p = dbhash->pkgs; p; p = alpm_list_next(p))
+			g_ptr_array_add(versions, g_strdup(dbhash_pkg_get_version(dbhash, p->data)));
+	}
+	for (i = 0; i < 10000; i++)
+		g_ptr_array_add(versions, bench_version());
+	keys = calloc(versions->len, sizeof(*keys));
+	numeric = calloc(versions->len, sizeof(*numeric));
+	for (i = 0; i < versions->len; i++)
+		if ((numeric[i] = verkey_parse(g_ptr_array_index(versions, i), &keys[i])))
+			nnumeric++;
+	pairs = calloc(2 * BENCH_VERCMP_PAIRS, sizeof(*pairs));
+	for (i = 0; i < 2 * BENCH_VERCMP_PAIRS; i++)
+		pairs[i] = random() % versions->len;
+
+	for (i = 0; i < BENCH_VERCMP_PAIRS; i++) {
+		size_t a = pairs[2 * i], b = pairs[2 * i + 1];
+		const char *va = g_ptr_array_index(versions, a);
+		const char *vb = g_ptr_array_index(versions, b);
+
+		result = alpm_pkg_vercmp(va, vb);
+		if (numeric[a] && numeric[b]) {
+			keyed++;
+			if (verkey_cmp(&keys[a], &keys[b]) != result) {
+				if (mismatches++ < 10)
+					fprintf(stdout, "  MISMATCH     %s <=> %s: alpm %d, keyed %d\n", va, vb,
+						result, verkey_cmp(&keys[a], &keys[b]));
 			}
-			/* skip local database */
-			for (s = slist->next; s; s = s->next) {
-				dbhash = s->data;
+		}
+		if (vercmp_memoized(va, vb) != result && mismatches++ < 10)
+			fprintf(stdout, "  MISMATCH     %s <=> %s: alpm %d, memoized\n", va, vb, result);
+	}
+	fprintf(stdout, "Version comparison: %u versions (%zu numeric), %d random pairs (%zu keyed):\n",
+		versions->len, nnumeric, BENCH_VERCMP_PAIRS, keyed);
+	fprintf(stdout, "  equivalence  %zu mismatches with alpm_pkg_vercmp\n", mismatches);
+
+	/* the comparisons are made as pac_vercmp() makes them: keyed when
+	   both versions are numeric */
+	for (round = 0; round < BENCH_ROUNDS; round++) {
+		double t;
+
+		start = pac_now();
+		for (i = 0, result = 0; i < BENCH_VERCMP_PAIRS; i++)
+			result += alpm_pkg_vercmp(g_ptr_array_index(versions, pairs[2 * i]),
+						  g_ptr_array_index(versions, pairs[2 * i + 1]));
+		t = pac_now() - start;
+		plain = plain && plain < t ? plain : t;
+		start = pac_now();
+		for (i = 0, result = 0; i < BENCH_VERCMP_PAIRS; i++) {
+			size_t a = pairs[2 * i], b = pairs[2 * i + 1];
+
+			if (numeric[a] && numeric[b])
+				result += verkey_cmp(&keys[a], &keys[b]);
+			else
+				result += alpm_pkg_vercmp(g_ptr_array_index(versions, a),
+							  g_ptr_array_index(versions, b));
+		}
+		t = pac_now() - start;
+		fast = fast && fast < t ? fast : t;
+		/* the pairs repeat from the second round on, as they do across
+		   analyses */
+		start = pac_now();
+		for (i = 0, result = 0; i < BENCH_VERCMP_PAIRS; i++) {
+			size_t a = pairs[2 * i], b = pairs[2 * i + 1];
+
+			if (numeric[a] && numeric[b])
+				result += verkey_cmp(&keys[a], &keys[b]);
+			else
+				result += vercmp_memoized(g_ptr_array_index(versions, a),
+							  g_ptr_array_index(versions, b));
+		}
+		t = pac_now() - start;
+		memo = memo && memo < t ? memo : t;
+	}
+	fprintf(stdout, "  %-12s %12.0f comparisons/s\n", "alpm", BENCH_VERCMP_PAIRS / plain * 1000.0);
+	fprintf(stdout, "  %-12s %12.0f comparisons/s\n", "keyed", BENCH_VERCMP_PAIRS / fast * 1000.0);
+	fprintf(stdout, "  %-12s %12.0f comparisons/s\n", "memoized", BENCH_VERCMP_PAIRS / memo * 1000.0);
+	vercmp_memo_free();
+	free(pairs);
+	free(numeric);
+	free(keys);
+	g_ptr_array_free(versions, TRUE);
+	return (mismatches);
+}
 
-				if (!dbhash->custom)
-					continue;
-				alpm_list_t *p;
+/** @brief check the packages of a database for one analysis as before the
+  * fused pass: walking the package list and calling the accessors again
+  */
+static void
+bench_legacy(GSList *s, const struct pac_analysis *an)
+{
+	struct dbhash *dbhash = s->data;
+	struct pkgitem item;
+	alpm_list_t *p;
 
-				for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-					alpm_pkg_t *pkg = p->data;
+	if (dbhash->select <= 0)
+		return;
+	for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
+		pkgitem_init(&item, dbhash, p->data);
+		an->check(s, &item);
+	}
+}
 
-					check_stranded_custom(s, pkg);
-				}
+/** @brief time the fused pass against one pass per analysis
+  *
+  * All check the packages of every database of the root for each of the
+  * selected analyses that are performed package by package, with the report
+  * output captured and discarded.  The legacy passes walk the package list of
+  * each database once per analysis, through the accessors, as was done before
+  * the package items; the separate passes do the same over the items.  The
+  * time to extract the items is shown separately.  Everything runs in one job
+  * so that the traversals compare alike.
+  */
+static void
+bench_driver(struct pacroot *root)
+{
+	const struct pac_analysis *checks[PAC_NANALYSES];
+	GString *outputs[PAC_NANALYSES] = { NULL, }, *outs[PAC_NANALYSES];
+	GString *capture = g_string_new(NULL);
+	double extract = 0, legacy = 0, separate = 0, fused = 0, start, t;
+	GSList *slist = root->slist, *s;
+	size_t a, b;
+	int i, n, nanalyses = 0, jobs = options.jobs;
+
+	options.jobs = 1;
+	start = pac_now();
+	pac_index(root);
+	extract = pac_now() - start;
+	pac_root = root;
+	provided = &root->provided;
+	for (a = 0; a < PAC_NANALYSES; a++)
+		if (pac_checked(&pac_analyses[a]))
+			nanalyses++;
+	report_capture = capture;
+	for (i = 0; i <= BENCH_ROUNDS; i++) {
+		/* one pass per analysis through the package lists */
+		start = pac_now();
+		for (a = 0; a < PAC_NANALYSES; a++) {
+			if (!pac_checked(&pac_analyses[a]))
+				continue;
+			outputs[a] = capture;
+			for (s = slist; s; s = s->next)
+				if (pac_select(slist, s, outputs, checks, outs))
+					bench_legacy(s, checks[0]);
+			outputs[a] = NULL;
+			g_string_truncate(capture, 0);
+		}
+		t = pac_now() - start;
+		if (i && (!legacy || t < legacy))
+			legacy = t;
+		/* one pass per analysis over the items */
+		start = pac_now();
+		for (a = 0; a < PAC_NANALYSES; a++) {
+			if (!pac_checked(&pac_analyses[a]))
+				continue;
+			outputs[a] = capture;
+			for (s = slist; s; s = s->next) {
+				n = pac_select(slist, s, outputs, checks, outs);
+				pac_foreach(s, checks, n, outs);
 			}
+			outputs[a] = NULL;
+			g_string_truncate(capture, 0);
 		}
-		OPRINTF(1, "Done\n\n");
-	}
-	if (options.analyses & PACANA_ANALYSIS_AURCHECK) {
-		OPRINTF(1, "Performing AURCHECK analysis:\n");
-		WPRINTF("TODO!\n");
-		OPRINTF(1, "Done\n\n");
-	}
-	if (options.analyses & PACANA_ANALYSIS_MISSING) {
-		OPRINTF(1, "Performing MISSING analysis:\n");
+		t = pac_now() - start;
+		if (i && (!separate || t < separate))
+			separate = t;
+		/* the fused pass */
+		for (a = 0; a < PAC_NANALYSES; a++)
+			if (pac_checked(&pac_analyses[a]))
+				outputs[a] = g_string_new(NULL);
+		start = pac_now();
 		for (s = slist; s; s = s->next) {
-			dbhash = s->data;
-			alpm_list_t *p;
-			for (p = dbhash->pkgs; p; p = alpm_list_next(p)) {
-				alpm_pkg_t *pkg = p->data;
-
-				check_missing(s, pkg);
-			}
+			n = pac_select(slist, s, outputs, checks, outs);
+			pac_foreach(s, checks, n, outs);
+		}
+		t = pac_now() - start;
+		if (i && (!fused || t < fused))
+			fused = t;
+		for (b = 0; b < PAC_NANALYSES; b++) {
+			if (outputs[b])
+				g_string_free(outputs[b], TRUE);
+			outputs[b] = NULL;
 		}
-		OPRINTF(1, "Done\n\n");
 	}
-	/* DO MORE! */
+	report_capture = NULL;
+	g_string_free(capture, TRUE);
+	vercmp_memo_free();
+	fprintf(stdout, "Analysis pass: %d analyses, 1 job, best of %d rounds:\n", nanalyses, BENCH_ROUNDS);
+	fprintf(stdout, "  %-12s %9.3f ms (once)\n", "extract", extract);
+	fprintf(stdout, "  %-12s %9.3f ms\n", "legacy", legacy);
+	fprintf(stdout, "  %-12s %9.3f ms\n", "separate", separate);
+	fprintf(stdout, "  %-12s %9.3f ms\n", "fused", fused);
+	if (fused)
+		fprintf(stdout, "  speedup      %9.2fx legacy, %.2fx separate, %.2fx legacy with extract\n",
+			legacy / fused, separate / fused, legacy / (fused + extract));
+	options.jobs = jobs;
+	pac_root = NULL;
+	provided = NULL;
+	idset_clear(&root->provided);
+}
+
+/** @brief run the benchmarks on the first root
+  * @return FALSE when the version comparisons failed the equivalence test
+  */
+static gboolean
+pac_benchmark(void)
+{
+	struct bench_result ghash = { 0, }, interned = { 0, }, r;
+	struct pacroot *root = options.roots->data;
+	GSList *slist, *s;
+	size_t npkgs = 0, mismatches;
+	int i;
 
+	pac_load(root, NULL);
+	slist = root->slist;
+	for (s = slist; s; s = s->next)
+		npkgs += alpm_list_count(((struct dbhash *) s->data)->pkgs);
+	/* the first pass also pulls any lazily loaded package data into memory */
+	fprintf(stdout, "Name index: %u databases, %zu packages, best of %d rounds:\n",
+		g_slist_length(slist), npkgs, BENCH_ROUNDS);
+	for (i = 0; i <= BENCH_ROUNDS; i++) {
+		bench_index_ghash(slist, &r);
+		if (i)
+			bench_best(&ghash, &r);
+		bench_index_interned(slist, &r);
+		if (i)
+			bench_best(&interned, &r);
+	}
+	bench_report("GHashTable", &ghash);
+	bench_report("interned", &interned);
+	if (interned.build && interned.lookup)
+		fprintf(stdout, "  speedup      build %9.2fx     lookup %9.2fx\n",
+			ghash.build / interned.build, ghash.lookup / interned.lookup);
+	mismatches = bench_vercmp(slist);
+	bench_driver(root);
 	g_slist_free_full(slist, destroy_dbhash);
-	alpm_unregister_all_syncdbs(handle);
+	root->slist = NULL;
+	alpm_unregister_all_syncdbs(root->handle);
+	alpm_release(root->handle);
+	if (mismatches) {
+		EPRINTF("%zu version comparisons disagree with alpm_pkg_vercmp\n", mismatches);
+		return (FALSE);
+	}
+	return (TRUE);
 }
 
 /** @} */
@@ -1451,12 +6846,40 @@ usage(int argc, char *argv[])
 	(void) fprintf(stderr, "\
 Usage:\n\
     %1$s [-A|--analyze] [options]\n\
+    %1$s {-B|--benchmark} [options]\n\
+    %1$s --daemon [SOCKET] [options]\n\
     %1$s {-h|--help} [options]\n\
     %1$s {-V|--version}\n\
     %1$s {-C|--copying}\n\
 ", argv[0]);
 }
 
+const char *
+show_method(Method method)
+{
+	switch (method) {
+	case MethodPost:
+		return ("post");
+	case MethodGet:
+		return ("get");
+	}
+	return ("unknown");
+}
+
+const char *
+show_format(Format format)
+{
+	switch (format) {
+	case FormatText:
+		return ("text");
+	case FormatJsonl:
+		return ("jsonl");
+	case FormatTsv:
+		return ("tsv");
+	}
+	return ("unknown");
+}
+
 const char *
 show_analyses(unsigned long analyses)
 {
@@ -1490,12 +6913,12 @@ show_analyses(unsigned long analyses)
 			strcat(buf, ",");
 		strcat(buf, "vcscheck");
 	}
-	if ((analyses & PACANA_ANALYSIS_STRANDED) && options.url) {
+	if ((analyses & PACANA_ANALYSIS_STRANDED) && aur_enabled()) {
 		if (*buf)
 			strcat(buf, ",");
 		strcat(buf, "stranded");
 	}
-	if ((analyses & PACANA_ANALYSIS_AURCHECK) && options.url) {
+	if ((analyses & PACANA_ANALYSIS_AURCHECK) && aur_enabled()) {
 		if (*buf)
 			strcat(buf, ",");
 		strcat(buf, "aurcheck");
@@ -1513,6 +6936,8 @@ help(int argc, char *argv[])
 	(void) fprintf(stdout, "\
 Usage:\n\
     %1$s [-A|--analyze] [options]\n\
+    %1$s {-B|--benchmark} [options]\n\
+    %1$s --daemon [SOCKET] [options]\n\
     %1$s {-h|--help} [options]\n\
     %1$s {-V|--version}\n\
     %1$s {-C|--copying}\n\
@@ -1520,6 +6945,10 @@ Options:\n\
   Command Options:\n\
    [-A, --analyze]\n\
         analyze pacman sync and local databases\n\
+    -B, --benchmark\n\
+        time internal operations on pacman sync and local databases\n\
+    --daemon [SOCKET]\n\
+        keep databases loaded and answer requests on SOCKET [default: %19$s]\n\
     -h, --help, -?, --?\n\
         print this usage information and exit\n\
     -V, --version\n\
@@ -1535,7 +6964,48 @@ Options:\n\
         specify which repositories to analyze [default: %6$s]\n\
     -c, --custom CUSTOM[,[!]CUSTOM]...\n\
         specify which repositories are custom [default: %7$s]\n\
+    -t, --ttl SECONDS\n\
+        seconds to reuse cached AUR results, 0 disables [default: %9$ld]\n\
+    -d, --cachedir DIRECTORY\n\
+        directory in which to cache AUR results [default: %10$s]\n\
+    -p, --parallel REQUESTS\n\
+        maximum concurrent AUR requests [default: %11$d]\n\
+    --method {post|get}\n\
+        send AUR requests as POST or GET requests [default: %20$s]\n\
+    -b, --batch NAMES\n\
+        maximum names per AUR POST request [default: %21$d]\n\
+    --rate REQUESTS\n\
+        maximum AUR requests per second, 0 for unlimited [default: %22$g]\n\
+    --retries TRIES\n\
+        times to retry a failed AUR request [default: %23$d]\n\
+    --record DIRECTORY\n\
+        record AUR responses in DIRECTORY [default: %24$s]\n\
+    --replay DIRECTORY\n\
+        answer AUR requests from responses recorded in DIRECTORY [default: %25$s]\n\
+    --aur-dump [FILE|URL]\n\
+        use AUR metadata dump instead of RPC [default: %12$s]\n\
+    --aur-all\n\
+        keep all packages from AUR metadata dump [default: %13$s]\n\
+    --incremental\n\
+        reuse findings of the previous run for unchanged packages [default: %18$s]\n\
+  Root Options:\n\
+    --root DIRECTORY\n\
+        analyze the installation root DIRECTORY, may be repeated [default: /]\n\
+    --dbpath DIRECTORY\n\
+        database directory of the root [default: ROOT/var/lib/pacman/]\n\
+    --config FILE\n\
+        pacman configuration file of the root [default: ROOT/etc/pacman.conf]\n\
+    --native\n\
+        read sync databases directly rather than with libalpm [default: %17$s]\n\
   General Options:\n\
+    -j, --jobs JOBS\n\
+        number of threads performing analyses, 0 for one per CPU [default: %14$d]\n\
+    --unbuffered\n\
+        write each line of output as it is produced [default: %15$s]\n\
+    -f, --format {text|jsonl|tsv}\n\
+        format in which to write findings [default: %16$s]\n\
+    --timings\n\
+        write the time spent in each phase of the analysis to stderr [default: %26$s]\n\
     -n, --dryrun\n\
         do not access AUR but print what would be done [default: %8$s]\n\
     -D, --debug [LEVEL]\n\
@@ -1551,6 +7021,24 @@ Options:\n\
 	, (options.repos ? : "all")
 	, (options.custom ? : "custom")
 	, (options.dryrun ? "enabled" : "disabled")
+	, options.ttl
+	, (options.cachedir ? : "none")
+	, options.parallel
+	, (options.dump ? : "disabled")
+	, (options.dumpall ? "enabled" : "disabled")
+	, options.jobs
+	, (options.unbuffered ? "enabled" : "disabled")
+	, show_format(options.format)
+	, (options.native ? "enabled" : "disabled")
+	, (options.incremental ? "enabled" : "disabled")
+	, (options.socket ? : "$XDG_RUNTIME_DIR/" NAME ".sock")
+	, show_method(options.method)
+	, options.batch
+	, options.rate
+	, options.retries
+	, (options.record ? : "disabled")
+	, (options.replay ? : "disabled")
+	, (options.timings ? "enabled" : "disabled")
 	);
 	/* *INDENT-ON* */
 }
@@ -1560,6 +7048,30 @@ set_defaults(int argc, char *argv[])
 {
 	(void) argc;
 	(void) argv;
+	char *dir;
+
+	dir = g_build_filename(g_get_user_cache_dir(), NAME, NULL);
+	options.cachedir = strdup(dir);
+	g_free(dir);
+}
+
+/** @brief get the root to which --dbpath or --config applies
+  *
+  * That is the root of the last --root option, unless that root already has
+  * the option set, in which case another root directory "/" is added.
+  */
+static struct pacroot *
+get_root(gboolean dbpath)
+{
+	GSList *last = g_slist_last(options.roots);
+	struct pacroot *root = last ? last->data : NULL;
+
+	if (!root || (dbpath ? root->dbpath : root->config)) {
+		root = calloc(1, sizeof(*root));
+		root->root = strdup("/");
+		options.roots = g_slist_append(options.roots, root);
+	}
+	return (root);
 }
 
 static void
@@ -1567,8 +7079,45 @@ get_defaults(int argc, char *argv[])
 {
 	(void) argc;
 	(void) argv;
+	GSList *r;
+
+	if (!options.roots)
+		get_root(TRUE);
+	for (r = options.roots; r; r = r->next) {
+		struct pacroot *root = r->data;
+
+		if (!root->dbpath)
+			root->dbpath = g_build_filename(root->root, "var/lib/pacman/", NULL);
+		if (!root->config)
+			root->config = g_build_filename(root->root, "etc/pacman.conf", NULL);
+	}
+	if (options.replay && !options.url)
+		options.url = strdup(AUR_DEFAULT_URL);
+	if (options.record || options.replay) {
+		/* each request must be made, and made the same way each time */
+		options.ttl = 0;
+	}
 }
 
+/* codes of the long options that have no short option */
+enum {
+	OptionDaemon = 256,
+	OptionMethod,
+	OptionRate,
+	OptionRetries,
+	OptionRecord,
+	OptionReplay,
+	OptionAurDump,
+	OptionAurAll,
+	OptionIncremental,
+	OptionUnbuffered,
+	OptionTimings,
+	OptionRoot,
+	OptionDbpath,
+	OptionConfig,
+	OptionNative,
+};
+
 int
 main(int argc, char *argv[]) {
 	Command command = CommandDefault;
@@ -1586,11 +7135,33 @@ main(int argc, char *argv[]) {
 		/* *INDENT-OFF* */
 		static struct option long_options[] = {
 			{"analyze",	no_argument,		NULL, 'A'},
+			{"benchmark",	no_argument,		NULL, 'B'},
+			{"daemon",	optional_argument,	NULL, OptionDaemon},
 			{"aur",		optional_argument,	NULL, 'a'},
 			{"which",	required_argument,	NULL, 'w'},
 			{"repos",	required_argument,	NULL, 'r'},
 			{"custom",	required_argument,	NULL, 'c'},
-
+			{"ttl",		required_argument,	NULL, 't'},
+			{"cachedir",	required_argument,	NULL, 'd'},
+			{"parallel",	required_argument,	NULL, 'p'},
+			{"method",	required_argument,	NULL, OptionMethod},
+			{"batch",	required_argument,	NULL, 'b'},
+			{"rate",	required_argument,	NULL, OptionRate},
+			{"retries",	required_argument,	NULL, OptionRetries},
+			{"record",	required_argument,	NULL, OptionRecord},
+			{"replay",	required_argument,	NULL, OptionReplay},
+			{"aur-dump",	optional_argument,	NULL, OptionAurDump},
+			{"aur-all",	no_argument,		NULL, OptionAurAll},
+			{"incremental",	no_argument,		NULL, OptionIncremental},
+
+			{"jobs",	required_argument,	NULL, 'j'},
+			{"unbuffered",	no_argument,		NULL, OptionUnbuffered},
+			{"timings",	no_argument,		NULL, OptionTimings},
+			{"format",	required_argument,	NULL, 'f'},
+			{"root",	required_argument,	NULL, OptionRoot},
+			{"dbpath",	required_argument,	NULL, OptionDbpath},
+			{"config",	required_argument,	NULL, OptionConfig},
+			{"native",	no_argument,		NULL, OptionNative},
 			{"dryrun",	no_argument,		NULL, 'n'},
 			{"debug",	optional_argument,	NULL, 'D'},
 			{"verbose",	optional_argument,	NULL, 'v'},
@@ -1602,10 +7173,10 @@ main(int argc, char *argv[]) {
 		};
 		/* *INDENT-ON* */
 
-		c = getopt_long_only(argc, argv, "Aa::w:r:c:nD::v::hVCH?", long_options,
+		c = getopt_long_only(argc, argv, "ABa::w:r:c:t:d:p:b:j:f:nD::v::hVCH?", long_options,
 				&option_index);
 #else				/* defined _GNU_SOURCE */
-		c = getopt(argc, argv, "Aa:w:r:c:nDvhVC?");
+		c = getopt(argc, argv, "ABa:w:r:c:t:d:p:b:j:f:nDvhVC?");
 #endif				/* defined _GNU_SOURCE */
 		if (c == -1) {
 			if (options.debug)
@@ -1622,6 +7193,24 @@ main(int argc, char *argv[]) {
 				command = CommandAnalyze;
 			options.command = CommandAnalyze;
 			break;
+		case 'B':	/* -B, --benchmark */
+			if (options.command != CommandDefault)
+				goto bad_command;
+			if (command == CommandDefault)
+				command = CommandBenchmark;
+			options.command = CommandBenchmark;
+			break;
+		case OptionDaemon:	/* --daemon [SOCKET] */
+			if (options.command != CommandDefault)
+				goto bad_command;
+			if (command == CommandDefault)
+				command = CommandDaemon;
+			options.command = CommandDaemon;
+			if (optarg) {
+				free(options.socket);
+				options.socket = strdup(optarg);
+			}
+			break;
 		case 'a':	/* -a, --aur [URL] */
 			free(options.url);
 			options.url = strdup(optarg ? : AUR_DEFAULT_URL);
@@ -1733,6 +7322,108 @@ main(int argc, char *argv[]) {
 			free(options.custom);
 			options.custom = strdup(optarg);
 			break;
+		case 't':	/* -t, --ttl SECONDS */
+			options.ttl = strtol(optarg, &endptr, 0);
+			if (*endptr || options.ttl < 0)
+				goto bad_option;
+			break;
+		case 'd':	/* -d, --cachedir DIRECTORY */
+			free(options.cachedir);
+			options.cachedir = strdup(optarg);
+			break;
+		case 'p':	/* -p, --parallel REQUESTS */
+			val = strtoul(optarg, &endptr, 0);
+			if (*endptr || val < 1)
+				goto bad_option;
+			options.parallel = val;
+			break;
+		case OptionMethod:	/* --method {post|get} */
+			if (!strcasecmp(optarg, "post"))
+				options.method = MethodPost;
+			else if (!strcasecmp(optarg, "get"))
+				options.method = MethodGet;
+			else
+				goto bad_option;
+			break;
+		case 'b':	/* -b, --batch NAMES */
+			val = strtoul(optarg, &endptr, 0);
+			if (*endptr || val < 1)
+				goto bad_option;
+			options.batch = val;
+			break;
+		case OptionRate:	/* --rate REQUESTS */
+			options.rate = strtod(optarg, &endptr);
+			if (*endptr || options.rate < 0)
+				goto bad_option;
+			break;
+		case OptionRetries:	/* --retries TRIES */
+			val = strtoul(optarg, &endptr, 0);
+			if (*endptr || val < 0)
+				goto bad_option;
+			options.retries = val;
+			break;
+		case OptionRecord:	/* --record DIRECTORY */
+			free(options.record);
+			/* also given as a file:// URL */
+			options.record = strdup(g_str_has_prefix(optarg, "file://") ? optarg + 7 : optarg);
+			break;
+		case OptionReplay:	/* --replay DIRECTORY */
+			free(options.replay);
+			options.replay = strdup(g_str_has_prefix(optarg, "file://") ? optarg + 7 : optarg);
+			break;
+		case OptionAurDump:	/* --aur-dump [FILE|URL] */
+			free(options.dump);
+			options.dump = strdup(optarg ? : AUR_DEFAULT_DUMP);
+			break;
+		case OptionAurAll:	/* --aur-all */
+			options.dumpall = 1;
+			break;
+		case 'j':	/* -j, --jobs JOBS */
+			val = strtoul(optarg, &endptr, 0);
+			if (*endptr || val < 0)
+				goto bad_option;
+			options.jobs = val ? : (int) g_get_num_processors();
+			break;
+		case OptionUnbuffered:	/* --unbuffered */
+			options.unbuffered = 1;
+			break;
+		case OptionTimings:	/* --timings */
+			options.timings = 1;
+			break;
+		case OptionRoot:	/* --root DIRECTORY */
+		{
+			struct pacroot *root = calloc(1, sizeof(*root));
+
+			root->root = strdup(optarg);
+			options.roots = g_slist_append(options.roots, root);
+			break;
+		}
+		case OptionDbpath:	/* --dbpath DIRECTORY */
+			get_root(TRUE)->dbpath = strdup(optarg);
+			break;
+		case OptionConfig:	/* --config FILE */
+			get_root(FALSE)->config = strdup(optarg);
+			break;
+		case OptionNative:	/* --native */
+#ifdef HAVE_LIBARCHIVE
+			options.native = 1;
+#else
+			fprintf(stderr, "%s: not built with libarchive, ignoring --native\n", argv[0]);
+#endif
+			break;
+		case OptionIncremental:	/* --incremental */
+			options.incremental = 1;
+			break;
+		case 'f':	/* -f, --format {text|jsonl|tsv} */
+			if (!strcasecmp(optarg, "text"))
+				options.format = FormatText;
+			else if (!strcasecmp(optarg, "jsonl"))
+				options.format = FormatJsonl;
+			else if (!strcasecmp(optarg, "tsv"))
+				options.format = FormatTsv;
+			else
+				goto bad_option;
+			break;
 		case 'n':	/* -n, --dryrun */
 			options.dryrun = 1;
 			break;
@@ -1804,6 +7495,10 @@ main(int argc, char *argv[]) {
 
 	get_defaults(argc, argv);
 
+	if (options.unbuffered)
+		report_threshold = 0;
+	atexit(report_flush);
+
 	switch (command) {
 	case CommandHelp:
 		if (options.debug)
@@ -1820,6 +7515,19 @@ main(int argc, char *argv[]) {
 			fprintf(stderr, "%s: printing copying message\n", argv[0]);
 		copying(argc, argv);
 		exit(EXIT_SUCCESS);
+	case CommandBenchmark:
+		if (options.debug)
+			fprintf(stderr, "%s: running benchmarks\n", argv[0]);
+		if (!pac_benchmark())
+			exit(EXIT_FAILURE);
+		exit(EXIT_SUCCESS);
+	case CommandDaemon:
+		if (!options.socket)
+			options.socket = daemon_socket();
+		if (options.debug)
+			fprintf(stderr, "%s: running daemon on %s\n", argv[0], options.socket);
+		pac_daemon();
+		exit(EXIT_SUCCESS);
 	case CommandDefault:
 		options.command = command = CommandAnalyze;
 		/* fall thru */